@@ -0,0 +1,355 @@
+#include "unistd.h"
+#include "usermode.h"
+
+/*
+ * lmbench-style microbenchmarks, run in U-mode in place of the smoke
+ * test when the kernel is built with CONFIG_BENCH (the `bench` target).
+ * Everything is printed as one JSON document between BENCH-BEGIN and
+ * BENCH-END lines so CI can cut it out of the serial log.
+ *
+ * Where the firmware exposes an SBI PMU, every row also carries
+ * per-op hardware event counts; rows get null for events the platform
+ * can't count, so the schema doesn't depend on the machine.
+ */
+
+#define BENCH_ITERS     1000
+#define BENCH_MAX_IO    4096
+#define BENCH_IO_ITERS  256
+#define BENCH_FILE      "/tmp/bench.dat"
+
+static const uint32_t io_sizes[] = { 64, 512, 4096 };
+
+struct bench_event {
+    const char *field;
+    struct perf_event_attr attr;
+};
+
+static const struct bench_event bench_events[] = {
+    { "instructions_per_op",
+      { PERF_TYPE_HARDWARE, 0, PERF_COUNT_HW_INSTRUCTIONS } },
+    { "dtlb_misses_per_op",
+      { PERF_TYPE_HW_CACHE, 0, PERF_CACHE_CONFIG(PERF_COUNT_HW_CACHE_DTLB,
+                                                 PERF_COUNT_HW_CACHE_OP_READ,
+                                                 PERF_COUNT_HW_CACHE_RESULT_MISS) } },
+};
+
+#define BENCH_EVENTS (sizeof(bench_events) / sizeof(bench_events[0]))
+
+static int event_fds[BENCH_EVENTS];
+static char io_buf[BENCH_MAX_IO];
+static uint64_t timebase_freq;
+static int results;
+
+static inline uint64_t rdcycle(void) {
+    uint64_t c;
+    asm volatile("rdcycle %0" : "=r"(c));
+    return c;
+}
+
+static inline uint64_t rdtime(void) {
+    uint64_t t;
+    asm volatile("rdtime %0" : "=r"(t));
+    return t;
+}
+
+// Always traps, unlike getpid() which reads the vDSO once attached
+static inline pid_t sys_getpid(void) {
+    register uint64_t a0 asm("a0");
+    register uint64_t a7 asm("a7") = 9;
+    asm volatile("ecall" : "=r"(a0) : "r"(a7) : "memory");
+    return (pid_t)a0;
+}
+
+struct sample {
+    uint64_t cycles;
+    uint64_t ticks;
+    uint64_t events[BENCH_EVENTS];
+};
+
+// An empty sample_start/sample_stop pair: the counter read()s land inside
+// the event deltas, so this is taken off every sample
+static struct sample overhead;
+
+static uint64_t less_overhead(uint64_t v, uint64_t cost) {
+    return v > cost ? v - cost : 0;
+}
+
+static uint64_t event_read(int i) {
+    uint64_t v = 0;
+    read(event_fds[i], &v, sizeof(v));
+    return v;
+}
+
+// The counter reads are syscalls, so they stay outside the timed window
+static inline void sample_start(struct sample *s) {
+    for (unsigned i = 0; i < BENCH_EVENTS; i++) {
+        s->events[i] = event_fds[i] >= 0 ? event_read(i) : 0;
+    }
+    s->cycles = rdcycle();
+    s->ticks = rdtime();
+}
+
+static inline void sample_stop(struct sample *s) {
+    s->cycles = less_overhead(rdcycle() - s->cycles, overhead.cycles);
+    s->ticks = less_overhead(rdtime() - s->ticks, overhead.ticks);
+    for (unsigned i = 0; i < BENCH_EVENTS; i++) {
+        uint64_t v = event_fds[i] >= 0 ? event_read(i) - s->events[i] : 0;
+        s->events[i] = less_overhead(v, overhead.events[i]);
+    }
+}
+
+static void sample_add(struct sample *total, const struct sample *s) {
+    total->cycles += s->cycles;
+    total->ticks += s->ticks;
+    for (unsigned i = 0; i < BENCH_EVENTS; i++) {
+        total->events[i] += s->events[i];
+    }
+}
+
+static void open_events(void) {
+    for (unsigned i = 0; i < BENCH_EVENTS; i++) {
+        event_fds[i] = perf_event_open(&bench_events[i].attr, 0);
+    }
+    
+    struct sample empty;
+    sample_start(&empty);
+    sample_stop(&empty);
+    overhead = empty;
+}
+
+static void out_str(const char *s) {
+    outbuf_puts(&stdout_buf, s);
+}
+
+static void out_u64(uint64_t n) {
+    char buf[24];
+    int i = 0;
+    do {
+        buf[i++] = '0' + n % 10;
+        n /= 10;
+    } while (n);
+    while (i > 0) {
+        outbuf_putc(&stdout_buf, buf[--i]);
+    }
+}
+
+/*
+ * One result object. iters == 0 marks a benchmark the kernel can't run
+ * yet; its numbers are null so a dashboard doesn't read them as zero.
+ * bytes is the transfer size for throughput rows and 0 otherwise.
+ */
+static void report(const char *name, uint32_t bytes, uint32_t iters, const struct sample *s) {
+    out_str(results++ ? ",\n    " : "\n    ");
+    out_str("{\"name\": \"");
+    out_str(name);
+    if (bytes) {
+        out_str("_");
+        out_u64(bytes);
+    }
+    out_str("\", \"iters\": ");
+    out_u64(iters);
+    
+    if (!iters) {
+        out_str(", \"cycles_per_op\": null, \"ns_per_op\": null");
+        for (unsigned i = 0; i < BENCH_EVENTS; i++) {
+            out_str(", \"");
+            out_str(bench_events[i].field);
+            out_str("\": null");
+        }
+        out_str("}");
+        return;
+    }
+    
+    out_str(", \"cycles_per_op\": ");
+    out_u64(s->cycles / iters);
+    out_str(", \"ns_per_op\": ");
+    out_u64(s->ticks * 1000000000ULL / timebase_freq / iters);
+    if (bytes && s->ticks) {
+        // bytes/s over 2^20, computed as bytes * freq / ticks
+        out_str(", \"mib_per_s\": ");
+        out_u64((uint64_t)bytes * iters * timebase_freq / s->ticks >> 20);
+    }
+    for (unsigned i = 0; i < BENCH_EVENTS; i++) {
+        out_str(", \"");
+        out_str(bench_events[i].field);
+        out_str("\": ");
+        if (event_fds[i] < 0) {
+            out_str("null");
+        } else {
+            out_u64(s->events[i] / iters);
+        }
+    }
+    out_str("}");
+}
+
+// gettid() does no work past the table dispatch every real syscall pays
+static void bench_null(void) {
+    struct sample s;
+    gettid();
+    sample_start(&s);
+    for (int i = 0; i < BENCH_ITERS; i++) {
+        gettid();
+    }
+    sample_stop(&s);
+    report("null_syscall", 0, BENCH_ITERS, &s);
+}
+
+static void bench_getpid(void) {
+    struct sample s;
+    sample_start(&s);
+    for (int i = 0; i < BENCH_ITERS; i++) {
+        sys_getpid();
+    }
+    sample_stop(&s);
+    report("getpid", 0, BENCH_ITERS, &s);
+    
+    sample_start(&s);
+    for (int i = 0; i < BENCH_ITERS; i++) {
+        getpid();
+    }
+    sample_stop(&s);
+    report("getpid_vdso", 0, BENCH_ITERS, &s);
+}
+
+static void bench_open_close(void) {
+    struct sample s;
+    int fd = open(BENCH_FILE, O_CREAT | O_TRUNC | O_WRONLY);
+    close(fd);
+    
+    sample_start(&s);
+    for (int i = 0; i < BENCH_ITERS; i++) {
+        close(open(BENCH_FILE, O_RDONLY));
+    }
+    sample_stop(&s);
+    report("open_close", 0, BENCH_ITERS, &s);
+}
+
+/*
+ * Files are capped at BENCH_MAX_IO bytes and there is no lseek, so every
+ * iteration reopens the file and only the transfer itself is timed.
+ */
+static void bench_io(void) {
+    for (unsigned k = 0; k < sizeof(io_sizes) / sizeof(io_sizes[0]); k++) {
+        uint32_t size = io_sizes[k];
+        struct sample total = { 0 }, s;
+        
+        for (int i = 0; i < BENCH_IO_ITERS; i++) {
+            int fd = open(BENCH_FILE, O_CREAT | O_TRUNC | O_WRONLY);
+            sample_start(&s);
+            write(fd, io_buf, size);
+            sample_stop(&s);
+            sample_add(&total, &s);
+            close(fd);
+        }
+        report("write", size, BENCH_IO_ITERS, &total);
+        
+        total = (struct sample){ 0 };
+        for (int i = 0; i < BENCH_IO_ITERS; i++) {
+            int fd = open(BENCH_FILE, O_RDONLY);
+            sample_start(&s);
+            read(fd, io_buf, size);
+            sample_stop(&s);
+            sample_add(&total, &s);
+            close(fd);
+        }
+        report("read", size, BENCH_IO_ITERS, &total);
+    }
+}
+
+/*
+ * Two threads hand a futex word back and forth; fork() has no address
+ * space to copy without an MMU, so the partner is a CLONE_THREAD that
+ * shares the word. Each round trip is two switches.
+ */
+static uint32_t pingpong;
+static uint8_t partner_stack[4096] __attribute__((aligned(16)));
+
+static void ctxsw_partner(void *arg) {
+    (void)arg;
+    for (int i = 0; i < BENCH_ITERS; i++) {
+        while (__atomic_load_n(&pingpong, __ATOMIC_ACQUIRE) != 1) {
+            futex(&pingpong, FUTEX_WAIT, 0, 0);
+        }
+        __atomic_store_n(&pingpong, 0, __ATOMIC_RELEASE);
+        futex(&pingpong, FUTEX_WAKE, 1, 0);
+    }
+}
+
+static void bench_ctxsw(void) {
+    struct sample s;
+    uint32_t partner_tid = 1;
+    __atomic_store_n(&pingpong, 0, __ATOMIC_RELAXED);
+    
+    pid_t partner = clone(ctxsw_partner, partner_stack + sizeof(partner_stack),
+                          CLONE_VM | CLONE_FILES | CLONE_THREAD | CLONE_CHILD_CLEARTID,
+                          0, 0, &partner_tid);
+    if (partner < 0) {
+        report("context_switch", 0, 0, 0);
+        return;
+    }
+    
+    sample_start(&s);
+    for (int i = 0; i < BENCH_ITERS; i++) {
+        __atomic_store_n(&pingpong, 1, __ATOMIC_RELEASE);
+        futex(&pingpong, FUTEX_WAKE, 1, 0);
+        while (__atomic_load_n(&pingpong, __ATOMIC_ACQUIRE) != 0) {
+            futex(&pingpong, FUTEX_WAIT, 1, 0);
+        }
+    }
+    sample_stop(&s);
+    
+    // Threads aren't wait()able; the cleared tid says the partner is gone
+    while (__atomic_load_n(&partner_tid, __ATOMIC_ACQUIRE) != 0) {
+        futex(&partner_tid, FUTEX_WAIT, 1, 0);
+    }
+    report("context_switch", 0, BENCH_ITERS * 2, &s);
+}
+
+static void bench_fork(void) {
+    struct sample s;
+    int status;
+    
+    sample_start(&s);
+    for (int i = 0; i < BENCH_IO_ITERS; i++) {
+        pid_t child = fork();
+        if (child == 0) {
+            exit(0);
+        }
+        if (child < 0) {
+            report("fork_wait", 0, 0, 0);
+            return;
+        }
+        wait(&status);
+    }
+    sample_stop(&s);
+    report("fork_wait", 0, BENCH_IO_ITERS, &s);
+}
+
+void bench_program(const struct vdso_data *vdso) {
+    vdso_attach(vdso);
+    timebase_freq = vdso->timebase_freq;
+    for (unsigned i = 0; i < sizeof(io_buf); i++) {
+        io_buf[i] = 'a' + i % 26;
+    }
+    
+    open_events();
+    
+    stdout_buf.mode = OUTBUF_FULL;
+    out_str("BENCH-BEGIN\n{\"timebase_hz\": ");
+    out_u64(timebase_freq);
+    out_str(", \"pmu\": ");
+    out_str(event_fds[0] >= 0 ? "true" : "false");
+    out_str(", \"results\": [");
+    
+    bench_null();
+    bench_getpid();
+    bench_open_close();
+    bench_io();
+    bench_ctxsw();
+    bench_fork();
+    
+    out_str("\n]}\nBENCH-END\n");
+    outbuf_flush(&stdout_buf);
+    
+    exit(0);
+}
@@ -0,0 +1,32 @@
+#ifndef BOOT_H
+#define BOOT_H
+
+// boot.S gives each hart 1 << BOOT_STACK_SHIFT bytes of boot stack
+#define BOOT_STACK_SHIFT 14
+
+#ifndef __ASSEMBLER__
+#include <stdint.h>
+
+/*
+ * Large buffers whose initial contents never matter (stacks, log
+ * buffers) go here instead of .bss, so clear_bss doesn't spend boot
+ * time zeroing them.
+ */
+#ifdef __riscv
+#define __noinit __attribute__((section(".noinit")))
+#else
+// Host build (host/): a custom section would be stored in the binary
+#define __noinit
+#endif
+
+#define BOOT_MAX_PHASES 16
+
+// Records the time CSR when phase finished
+void boot_mark(const char *phase);
+void boot_report(void);
+
+// Flushes the console and powers the machine off; code != 0 reports failure
+void kernel_poweroff(int code);
+
+#endif
+#endif
@@ -0,0 +1,304 @@
+#include "epoll.h"
+#include "fs.h"
+#include "process.h"
+#include "timer.h"
+#include "riscv.h"
+#include <stddef.h>
+
+/*
+ * One epitem per (instance, fd) registration. Items hang off the watched
+ * fd so a notification only touches that fd's watchers, and ready items
+ * sit on a per-instance FIFO so epoll_wait costs O(ready).
+ */
+struct epitem {
+    int in_use;
+    int ep;
+    int fd;
+    uint32_t events;
+    uint64_t data;
+    int queued;
+    struct epitem *rdnext;
+    struct epitem *watch_next;
+};
+
+typedef struct {
+    int in_use;
+    struct epitem *ready_head;
+    struct epitem *ready_tail;
+    int nready;
+    process_t *waiter;
+} eventpoll_t;
+
+static eventpoll_t eventpolls[MAX_EPOLL];
+static struct epitem epitems[MAX_EPOLL_ITEMS];
+
+static eventpoll_t *ep_from_fd(int epfd) {
+    if (epfd < 0 || epfd >= MAX_FDS || !fd_table[epfd].in_use ||
+        fd_table[epfd].type != FD_EPOLL) {
+        return NULL;
+    }
+    return &eventpolls[fd_table[epfd].file_idx];
+}
+
+static void ready_enqueue(eventpoll_t *ep, struct epitem *item) {
+    if (item->queued) return;
+    
+    item->queued = 1;
+    item->rdnext = NULL;
+    if (ep->ready_tail) {
+        ep->ready_tail->rdnext = item;
+    } else {
+        ep->ready_head = item;
+    }
+    ep->ready_tail = item;
+    ep->nready++;
+}
+
+static struct epitem *ready_dequeue(eventpoll_t *ep) {
+    struct epitem *item = ep->ready_head;
+    if (!item) return NULL;
+    
+    ep->ready_head = item->rdnext;
+    if (!ep->ready_head) {
+        ep->ready_tail = NULL;
+    }
+    item->queued = 0;
+    item->rdnext = NULL;
+    ep->nready--;
+    return item;
+}
+
+static void ready_remove(eventpoll_t *ep, struct epitem *item) {
+    if (!item->queued) return;
+    
+    struct epitem *prev = NULL;
+    for (struct epitem *it = ep->ready_head; it; prev = it, it = it->rdnext) {
+        if (it != item) continue;
+        if (prev) {
+            prev->rdnext = it->rdnext;
+        } else {
+            ep->ready_head = it->rdnext;
+        }
+        if (ep->ready_tail == it) {
+            ep->ready_tail = prev;
+        }
+        break;
+    }
+    item->queued = 0;
+    item->rdnext = NULL;
+    ep->nready--;
+}
+
+static void ep_wake(eventpoll_t *ep) {
+    process_t *waiter = ep->waiter;
+    if (!waiter) return;
+    
+    ep->waiter = NULL;
+    timer_cancel(&waiter->timeout);
+    process_wake_restart(waiter);
+}
+
+static void watch_unlink(struct epitem *item) {
+    struct epitem **pp = &fd_table[item->fd].watchers;
+    while (*pp) {
+        if (*pp == item) {
+            *pp = item->watch_next;
+            break;
+        }
+        pp = &(*pp)->watch_next;
+    }
+    item->watch_next = NULL;
+}
+
+static void item_free(struct epitem *item) {
+    ready_remove(&eventpolls[item->ep], item);
+    item->in_use = 0;
+}
+
+int epoll_create(void) {
+    for (int i = 0; i < MAX_EPOLL; i++) {
+        if (eventpolls[i].in_use) continue;
+        
+        int fd = fs_alloc_fd(FD_EPOLL, i, O_RDONLY);
+        if (fd < 0) return -1;
+        
+        eventpolls[i].in_use = 1;
+        eventpolls[i].ready_head = NULL;
+        eventpolls[i].ready_tail = NULL;
+        eventpolls[i].nready = 0;
+        eventpolls[i].waiter = NULL;
+        return fd;
+    }
+    return -1;
+}
+
+int epoll_ctl(int epfd, int op, int fd, const struct epoll_event *event) {
+    eventpoll_t *ep = ep_from_fd(epfd);
+    if (!ep || fd < 0 || fd >= MAX_FDS || !fd_table[fd].in_use || fd == epfd) {
+        return -1;
+    }
+    
+    int ep_idx = ep - eventpolls;
+    struct epitem *item = fd_table[fd].watchers;
+    while (item && item->ep != ep_idx) {
+        item = item->watch_next;
+    }
+    
+    switch (op) {
+        case EPOLL_CTL_ADD:
+            if (item || !event) return -1;
+            for (int i = 0; i < MAX_EPOLL_ITEMS; i++) {
+                if (!epitems[i].in_use) {
+                    item = &epitems[i];
+                    break;
+                }
+            }
+            if (!item) return -1;
+            
+            item->in_use = 1;
+            item->ep = ep_idx;
+            item->fd = fd;
+            item->queued = 0;
+            item->rdnext = NULL;
+            item->watch_next = fd_table[fd].watchers;
+            fd_table[fd].watchers = item;
+            break;
+            
+        case EPOLL_CTL_MOD:
+            if (!item || !event) return -1;
+            break;
+            
+        case EPOLL_CTL_DEL:
+            if (!item) return -1;
+            watch_unlink(item);
+            item_free(item);
+            return 0;
+            
+        default:
+            return -1;
+    }
+    
+    item->events = event->events;
+    item->data = event->data;
+    
+    // Catch up on readiness that predates the registration
+    if (fs_poll(fd) & item->events) {
+        ready_enqueue(ep, item);
+        ep_wake(ep);
+    }
+    return 0;
+}
+
+static int ep_collect(eventpoll_t *ep, struct epoll_event *events, int maxevents) {
+    int n = 0;
+    int pending = ep->nready;
+    
+    while (pending-- > 0 && n < maxevents) {
+        struct epitem *item = ready_dequeue(ep);
+        uint32_t revents = fs_poll(item->fd) & (item->events | EPOLLERR | EPOLLHUP);
+        if (!revents) continue;
+        
+        events[n].events = revents;
+        events[n].data = item->data;
+        n++;
+        
+        // Level-triggered items stay ready until a poll says otherwise
+        if (!(item->events & EPOLLET)) {
+            ready_enqueue(ep, item);
+        }
+    }
+    return n;
+}
+
+static void epoll_timeout(struct timer *t) {
+    eventpoll_t *ep = (eventpoll_t *)t->arg;
+    process_t *waiter = ep->waiter;
+    if (!waiter) return;
+    
+    ep->waiter = NULL;
+    waiter->wait_deadline = 0;
+    process_wake(waiter, 0);
+}
+
+static void epoll_cancel(process_t *proc) {
+    eventpoll_t *ep = (eventpoll_t *)proc->wait_obj;
+    if (ep->waiter == proc) {
+        ep->waiter = NULL;
+    }
+    proc->wait_deadline = 0;
+}
+
+int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout_ms) {
+    eventpoll_t *ep = ep_from_fd(epfd);
+    process_t *proc = process_current();
+    if (!ep || !proc || !events || maxevents <= 0 || ep->waiter) {
+        return -1;
+    }
+    
+    int n = ep_collect(ep, events, maxevents);
+    if (n > 0 || timeout_ms == 0) {
+        proc->wait_deadline = 0;
+        return n;
+    }
+    
+    // A restart after a notification that left nothing to collect keeps
+    // the deadline of the first pass rather than starting a new timeout
+    if (timeout_ms > 0) {
+        uint64_t now = read_time();
+        if (!proc->wait_deadline) {
+            proc->wait_deadline = now + timer_ns_to_ticks((uint64_t)timeout_ms * 1000000);
+        } else if (proc->wait_deadline <= now) {
+            proc->wait_deadline = 0;
+            return 0;
+        }
+    }
+    
+    // A notification restarts the call, which then collects; a timeout
+    // completes it with 0 events.
+    ep->waiter = proc;
+    proc->wait_obj = ep;
+    proc->cancel_wait = epoll_cancel;
+    if (timeout_ms > 0) {
+        timer_add_slack(&proc->timeout, proc->wait_deadline, proc->timer_slack, epoll_timeout, ep);
+    }
+    return (int)process_block();
+}
+
+void epoll_notify(int fd, uint32_t events) {
+    for (struct epitem *item = fd_table[fd].watchers; item; item = item->watch_next) {
+        if (!(events & (item->events | EPOLLERR | EPOLLHUP))) continue;
+        
+        eventpoll_t *ep = &eventpolls[item->ep];
+        ready_enqueue(ep, item);
+        ep_wake(ep);
+    }
+}
+
+void epoll_forget_fd(int fd) {
+    struct epitem *item = fd_table[fd].watchers;
+    while (item) {
+        struct epitem *next = item->watch_next;
+        item->watch_next = NULL;
+        item_free(item);
+        item = next;
+    }
+    fd_table[fd].watchers = NULL;
+}
+
+void epoll_destroy(int ep_idx) {
+    eventpoll_t *ep = &eventpolls[ep_idx];
+    
+    for (int i = 0; i < MAX_EPOLL_ITEMS; i++) {
+        if (epitems[i].in_use && epitems[i].ep == ep_idx) {
+            watch_unlink(&epitems[i]);
+            item_free(&epitems[i]);
+        }
+    }
+    
+    if (ep->waiter) {
+        timer_cancel(&ep->waiter->timeout);
+        process_wake(ep->waiter, -1);
+        ep->waiter = NULL;
+    }
+    ep->in_use = 0;
+}
@@ -0,0 +1,31 @@
+#ifndef EPOLL_H
+#define EPOLL_H
+
+#include <stdint.h>
+
+#define MAX_EPOLL 8
+#define MAX_EPOLL_ITEMS 64
+
+#define EPOLL_CTL_ADD 1
+#define EPOLL_CTL_DEL 2
+#define EPOLL_CTL_MOD 3
+
+#define EPOLLIN  0x001
+#define EPOLLOUT 0x004
+#define EPOLLERR 0x008
+#define EPOLLHUP 0x010
+#define EPOLLET  (1U << 31)
+
+struct epoll_event {
+    uint32_t events;
+    uint64_t data;
+};
+
+int epoll_create(void);
+int epoll_ctl(int epfd, int op, int fd, const struct epoll_event *event);
+int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout_ms);
+void epoll_notify(int fd, uint32_t events);
+void epoll_forget_fd(int fd);
+void epoll_destroy(int ep);
+
+#endif
@@ -1,9 +1,23 @@
 #include "fs.h"
 #include "printk.h"
+#include "epoll.h"
+#include "uart.h"
+#include "spinlock.h"
+#include "perf.h"
+#include "shm.h"
+#include "trace.h"
+#include <stddef.h>
 
 file_t file_table[MAX_FILES];
 fd_t fd_table[MAX_FDS];
 
+/*
+ * Covers file_table and fd_table. IRQ-safe because the UART interrupt
+ * walks fd_table for console watchers. Never held across a blocking
+ * console read or a driver write.
+ */
+static spinlock_t fs_lock;
+
 static int strcmp_simple(const char *a, const char *b) {
     while (*a && *b && *a == *b) {
         a++;
@@ -22,20 +36,41 @@ static void strcpy_simple(char *dst, const char *src, int max) {
 
 void fs_init(void) {
     printk("Initializing filesystem...\n");
+    spin_init(&fs_lock, "fs");
     
-    for (int i = 0; i < MAX_FILES; i++) {
-        file_table[i].in_use = 0;
-        file_table[i].size = 0;
-    }
+    // First free slots, so these land on STDIN_FD, STDOUT_FD and STDERR_FD
+    fs_alloc_fd(FD_CONSOLE, 0, O_RDONLY);
+    fs_alloc_fd(FD_CONSOLE, 0, O_WRONLY);
+    fs_alloc_fd(FD_CONSOLE, 0, O_WRONLY);
     
+    printk("Filesystem initialized\n");
+}
+
+static int fd_alloc_locked(int type, int idx, int flags) {
     for (int i = 0; i < MAX_FDS; i++) {
-        fd_table[i].in_use = 0;
+        if (!fd_table[i].in_use) {
+            fd_table[i].in_use = 1;
+            fd_table[i].type = type;
+            fd_table[i].file_idx = idx;
+            fd_table[i].flags = flags;
+            fd_table[i].offset = 0;
+            fd_table[i].watchers = NULL;
+            return i;
+        }
     }
     
-    printk("Filesystem initialized\n");
+    return -1;
+}
+
+int fs_alloc_fd(int type, int idx, int flags) {
+    uint64_t irq = spin_lock_irqsave(&fs_lock);
+    int fd = fd_alloc_locked(type, idx, flags);
+    spin_unlock_irqrestore(&fs_lock, irq);
+    return fd;
 }
 
 int fs_open(const char *path, int flags) {
+    uint64_t irq = spin_lock_irqsave(&fs_lock);
     int file_idx = -1;
     
     for (int i = 0; i < MAX_FILES; i++) {
@@ -58,6 +93,7 @@ int fs_open(const char *path, int flags) {
     }
     
     if (file_idx == -1) {
+        spin_unlock_irqrestore(&fs_lock, irq);
         return -1;
     }
 
@@ -65,41 +101,122 @@ int fs_open(const char *path, int flags) {
         file_table[file_idx].size = 0;
     }
 
-    for (int i = 0; i < MAX_FDS; i++) {
-        if (!fd_table[i].in_use) {
-            fd_table[i].in_use = 1;
-            fd_table[i].file_idx = file_idx;
-            fd_table[i].flags = flags;
-            fd_table[i].offset = 0;
-            return i;
-        }
-    }
-    
-    return -1;
+    int fd = fd_alloc_locked(FD_FILE, file_idx, flags);
+    trace(TRACE_FS_OPEN, fd, file_idx);
+    spin_unlock_irqrestore(&fs_lock, irq);
+    return fd;
+}
+
+static int fd_valid(int fd) {
+    return fd >= 0 && fd < MAX_FDS && fd_table[fd].in_use;
 }
 
 int fs_close(int fd) {
-    if (fd < 0 || fd >= MAX_FDS || !fd_table[fd].in_use) {
+    uint64_t irq = spin_lock_irqsave(&fs_lock);
+    if (!fd_valid(fd)) {
+        spin_unlock_irqrestore(&fs_lock, irq);
         return -1;
     }
     
+    // Descriptors are system-wide, and these three are every process's
+    // stdio: closing one can't take it away from everybody else
+    if (fd <= STDERR_FD && fd_table[fd].type == FD_CONSOLE) {
+        spin_unlock_irqrestore(&fs_lock, irq);
+        return 0;
+    }
+    
+    if (fd_table[fd].watchers) {
+        epoll_forget_fd(fd);
+    }
+    if (fd_table[fd].type == FD_EPOLL) {
+        epoll_destroy(fd_table[fd].file_idx);
+    }
+    if (fd_table[fd].type == FD_PERF) {
+        perf_release(fd_table[fd].file_idx);
+    }
+    if (fd_table[fd].type == FD_SHM) {
+        shm_close(fd_table[fd].file_idx);
+    }
+    
     fd_table[fd].in_use = 0;
+    spin_unlock_irqrestore(&fs_lock, irq);
     return 0;
 }
 
+// RAM files never block, so readiness only depends on the access mode
+uint32_t fs_poll(int fd) {
+    uint64_t irq = spin_lock_irqsave(&fs_lock);
+    if (!fd_valid(fd)) {
+        spin_unlock_irqrestore(&fs_lock, irq);
+        return POLLERR;
+    }
+    
+    int type = fd_table[fd].type;
+    int mode = fd_table[fd].flags & 3;
+    spin_unlock_irqrestore(&fs_lock, irq);
+    
+    if (type == FD_CONSOLE) {
+        uint32_t mask = mode == O_RDONLY ? POLLIN : POLLOUT;
+        return uart_poll() & mask;
+    }
+    if (type != FD_FILE) {
+        return 0;
+    }
+    
+    switch (mode) {
+        case O_RDONLY: return POLLIN;
+        case O_WRONLY: return POLLOUT;
+        default:       return POLLIN | POLLOUT;
+    }
+}
+
+// New data on a file is an edge for every descriptor open on it
+static void fs_notify_file(int file_idx, uint32_t events) {
+    for (int i = 0; i < MAX_FDS; i++) {
+        if (fd_table[i].in_use && fd_table[i].watchers &&
+            fd_table[i].type == FD_FILE && fd_table[i].file_idx == file_idx) {
+            epoll_notify(i, events);
+        }
+    }
+}
+
+void fs_notify_console(uint32_t events) {
+    uint64_t irq = spin_lock_irqsave(&fs_lock);
+    for (int i = 0; i < MAX_FDS; i++) {
+        if (fd_table[i].in_use && fd_table[i].watchers && fd_table[i].type == FD_CONSOLE) {
+            epoll_notify(i, events);
+        }
+    }
+    spin_unlock_irqrestore(&fs_lock, irq);
+}
+
 int fs_read(int fd, void *buf, uint32_t count) {
-    if (fd < 0 || fd >= MAX_FDS || !fd_table[fd].in_use) {
+    trace(TRACE_FS_READ, fd, count);
+    uint64_t irq = spin_lock_irqsave(&fs_lock);
+    if (!fd_valid(fd)) {
+        spin_unlock_irqrestore(&fs_lock, irq);
         return -1;
     }
     
     fd_t *fdesc = &fd_table[fd];
-    file_t *file = &file_table[fdesc->file_idx];
-    
-    if ((fdesc->flags & 3) == O_WRONLY) {
+    if (fdesc->type == FD_CONSOLE && (fdesc->flags & 3) != O_WRONLY) {
+        // May sleep for a line of input
+        spin_unlock_irqrestore(&fs_lock, irq);
+        return uart_read(buf, count);
+    }
+    if (fdesc->type == FD_PERF) {
+        int idx = fdesc->file_idx;
+        spin_unlock_irqrestore(&fs_lock, irq);
+        return perf_read(idx, buf, count);
+    }
+    if (fdesc->type != FD_FILE || (fdesc->flags & 3) == O_WRONLY) {
+        spin_unlock_irqrestore(&fs_lock, irq);
         return -1;
     }
+    file_t *file = &file_table[fdesc->file_idx];
     
-    uint32_t available = file->size - fdesc->offset;
+    // O_TRUNC through another descriptor can leave offset past the end
+    uint32_t available = fdesc->offset < file->size ? file->size - fdesc->offset : 0;
     if (count > available) {
         count = available;
     }
@@ -110,22 +227,33 @@ int fs_read(int fd, void *buf, uint32_t count) {
     }
     
     fdesc->offset += count;
+    spin_unlock_irqrestore(&fs_lock, irq);
     return count;
 }
 
 int fs_write(int fd, const void *buf, uint32_t count) {
-    if (fd < 0 || fd >= MAX_FDS || !fd_table[fd].in_use) {
+    trace(TRACE_FS_WRITE, fd, count);
+    uint64_t irq = spin_lock_irqsave(&fs_lock);
+    if (!fd_valid(fd)) {
+        spin_unlock_irqrestore(&fs_lock, irq);
         return -1;
     }
     
     fd_t *fdesc = &fd_table[fd];
-    file_t *file = &file_table[fdesc->file_idx];
-    
-    if ((fdesc->flags & 3) == O_RDONLY) {
+    if (fdesc->type == FD_CONSOLE && (fdesc->flags & 3) != O_RDONLY) {
+        spin_unlock_irqrestore(&fs_lock, irq);
+        // Keep ordering with kernel messages still sitting in printk rings
+        printk_flush();
+        return uart_write(buf, count);
+    }
+    if (fdesc->type != FD_FILE || (fdesc->flags & 3) == O_RDONLY) {
+        spin_unlock_irqrestore(&fs_lock, irq);
         return -1;
     }
+    file_t *file = &file_table[fdesc->file_idx];
     
-    if (fdesc->offset + count > MAX_FILESIZE) {
+    // Written so a huge count can't wrap the sum back under the limit
+    if (count > MAX_FILESIZE - fdesc->offset) {
         count = MAX_FILESIZE - fdesc->offset;
     }
     
@@ -140,5 +268,10 @@ int fs_write(int fd, const void *buf, uint32_t count) {
         file->size = fdesc->offset;
     }
     
+    if (count > 0) {
+        fs_notify_file(fdesc->file_idx, POLLIN);
+    }
+    
+    spin_unlock_irqrestore(&fs_lock, irq);
     return count;
 }
@@ -13,6 +13,24 @@
 #define O_RDWR   2
 #define O_CREAT  0x100
 #define O_TRUNC  0x200
+#define O_EXCL   0x400
+
+#define STDIN_FD  0
+#define STDOUT_FD 1
+#define STDERR_FD 2
+
+#define FD_FILE    0
+#define FD_EPOLL   1
+#define FD_CONSOLE 2
+#define FD_PERF    3
+#define FD_SHM     4
+
+#define POLLIN  0x001
+#define POLLOUT 0x004
+#define POLLERR 0x008
+#define POLLHUP 0x010
+
+struct epitem;
 
 typedef struct {
     char name[MAX_FILENAME];
@@ -22,10 +40,12 @@ typedef struct {
 } file_t;
 
 typedef struct {
+    int type;
     int file_idx;
     int flags;
     uint32_t offset;
     int in_use;
+    struct epitem *watchers;
 } fd_t;
 
 extern file_t file_table[MAX_FILES];
@@ -36,5 +56,8 @@ int fs_open(const char *path, int flags);
 int fs_close(int fd);
 int fs_read(int fd, void *buf, uint32_t count);
 int fs_write(int fd, const void *buf, uint32_t count);
+int fs_alloc_fd(int type, int idx, int flags);
+uint32_t fs_poll(int fd);
+void fs_notify_console(uint32_t events);
 
 #endif
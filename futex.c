@@ -0,0 +1,93 @@
+#include "futex.h"
+#include "process.h"
+#include <stddef.h>
+
+// FIFO wait queues, chained through process_t.futex_next
+static process_t *futex_queues[FUTEX_HASH_SIZE];
+
+/*
+ * Waiters are keyed by physical address so that two mappings of the same
+ * word meet in one queue. Paging is not enabled, so that is the address.
+ */
+static uint64_t futex_key(const uint32_t *uaddr) {
+    return (uint64_t)uaddr;
+}
+
+static process_t **futex_bucket(uint64_t key) {
+    uint64_t hash = (key >> 2) * 0x9E3779B97F4A7C15ULL;
+    return &futex_queues[hash >> (64 - FUTEX_HASH_BITS)];
+}
+
+static void futex_dequeue(process_t **bucket, process_t *proc) {
+    for (process_t **pp = bucket; *pp; pp = &(*pp)->futex_next) {
+        if (*pp == proc) {
+            *pp = proc->futex_next;
+            proc->futex_next = NULL;
+            return;
+        }
+    }
+}
+
+static void futex_timeout(struct timer *t) {
+    process_t *proc = (process_t *)t->arg;
+    futex_dequeue(futex_bucket(proc->futex_key), proc);
+    process_wake(proc, -1);
+}
+
+static void futex_cancel(process_t *proc) {
+    futex_dequeue(futex_bucket(proc->futex_key), proc);
+}
+
+int futex_wait(uint32_t *uaddr, uint32_t val, uint64_t deadline) {
+    process_t *proc = process_current();
+    if (!proc || ((uint64_t)uaddr & 3)) return -1;
+    
+    // Value already changed: the caller lost a race with a waker
+    if (__atomic_load_n(uaddr, __ATOMIC_ACQUIRE) != val) {
+        return -1;
+    }
+    
+    uint64_t key = futex_key(uaddr);
+    process_t **tail = futex_bucket(key);
+    while (*tail) {
+        tail = &(*tail)->futex_next;
+    }
+    proc->futex_key = key;
+    proc->futex_next = NULL;
+    *tail = proc;
+    proc->cancel_wait = futex_cancel;
+    
+    if (deadline) {
+        timer_add_slack(&proc->timeout, deadline, proc->timer_slack, futex_timeout, proc);
+    }
+    // futex_wake returns 0 through it, futex_timeout and signals -1
+    return (int)process_block();
+}
+
+int futex_wake(uint32_t *uaddr, int count) {
+    if ((uint64_t)uaddr & 3) return -1;
+    
+    uint64_t key = futex_key(uaddr);
+    process_t **pp = futex_bucket(key);
+    int woken = 0;
+    
+    while (*pp && woken < count) {
+        process_t *proc = *pp;
+        if (proc->futex_key != key) {
+            pp = &proc->futex_next;
+            continue;
+        }
+        
+        *pp = proc->futex_next;
+        proc->futex_next = NULL;
+        
+        // Killed while waiting; just drop it from the queue
+        if (proc->state != PROC_BLOCKED) continue;
+        
+        timer_cancel(&proc->timeout);
+        process_wake(proc, 0);
+        woken++;
+    }
+    
+    return woken;
+}
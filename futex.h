@@ -0,0 +1,16 @@
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include <stdint.h>
+
+#define FUTEX_WAIT 0
+#define FUTEX_WAKE 1
+
+#define FUTEX_HASH_BITS 6
+#define FUTEX_HASH_SIZE (1 << FUTEX_HASH_BITS)
+
+// deadline is in time CSR ticks, 0 waits forever
+int futex_wait(uint32_t *uaddr, uint32_t val, uint64_t deadline);
+int futex_wake(uint32_t *uaddr, int count);
+
+#endif
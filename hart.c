@@ -0,0 +1,40 @@
+#include "hart.h"
+#include "printk.h"
+#include "vdso.h"
+#include "riscv.h"
+#include "timer.h"
+#include <stddef.h>
+
+struct hart harts[MAX_HARTS];
+
+_Static_assert(offsetof(struct hart, kernel_sp) == HART_KSTACK, "trap.S offset");
+_Static_assert(offsetof(struct hart, scratch_sp) == HART_SCRATCH_SP, "trap.S offset");
+_Static_assert(offsetof(struct hart, user_tp) == HART_USER_TP, "trap.S offset");
+_Static_assert(offsetof(struct hart, id) == HART_ID, "boot.S offset");
+_Static_assert(sizeof(struct hart) == 1 << HART_SHIFT, "boot.S indexes harts[] by shift");
+
+// boot.S already pointed tp here and filled in id
+void hart_init(void *kernel_stack_top) {
+    struct hart *h = this_hart();
+    h->kernel_sp = (uint64_t)kernel_stack_top;
+    h->irq_depth = 0;
+    h->need_resched = 0;
+}
+
+void hart_dump_stats(void) {
+    for (int i = 0; i < MAX_HARTS; i++) {
+        const struct hart *h = &harts[i];
+        if (!h->stats.traps) continue;
+        printk("Hart %lu: %lu traps, %lu syscalls, %lu interrupts, %lu switches, %lu idle cycles\n",
+               h->id, h->stats.traps, h->stats.syscalls, h->stats.interrupts,
+               h->stats.switches, h->stats.idle_cycles);
+        
+        uint64_t uptime = read_time() - vdso_page.boot_time;
+        if (!h->stats.idle_entries || !uptime) continue;
+        uint64_t permille = h->stats.idle_time * 1000 / uptime;
+        printk("  idle %lu.%lu%% over %lu entries (avg %luus), %lu scheduler ticks\n",
+               permille / 10, permille % 10, h->stats.idle_entries,
+               timer_ticks_to_ns(h->stats.idle_time / h->stats.idle_entries) / 1000,
+               h->stats.ticks);
+    }
+}
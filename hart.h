@@ -0,0 +1,78 @@
+#ifndef HART_H
+#define HART_H
+
+#include <stdint.h>
+#include "trap.h"
+
+#define CACHE_LINE_SIZE 64
+
+// Offsets used by trap.S and boot.S; hart.c checks them
+#define HART_KSTACK     0
+#define HART_SCRATCH_SP 8
+#define HART_USER_TP    16
+#define HART_ID         24
+#define HART_SHIFT      8
+
+/*
+ * Per-hart state, reached through tp while in the kernel. Each group
+ * sits on its own cache line: the trap-entry line is read on every trap,
+ * the run queue is written by wakers, and the counters are bumped
+ * constantly, so none of them drags the others between harts. The whole
+ * struct is 1 << HART_SHIFT bytes so boot.S can index harts[] by shift.
+ */
+struct hart {
+    // Trap entry and exit
+    uint64_t kernel_sp;
+    uint64_t scratch_sp;
+    uint64_t user_tp;
+    uint64_t id;
+    int current_pid;
+    int running_pid;
+    uint32_t irq_depth;
+    // A deadline task became runnable ahead of whatever is running
+    uint32_t need_resched;
+    
+    // Ready process slots in FIFO order, indexed by proc_table position
+    struct {
+        uint8_t slots[64];
+        uint32_t head;
+        uint32_t tail;
+    } runq __attribute__((aligned(CACHE_LINE_SIZE)));
+    
+    struct {
+        uint64_t traps;
+        uint64_t syscalls;
+        uint64_t interrupts;
+        uint64_t switches;
+        uint64_t idle_cycles;
+        // Time CSR ticks spent idle, for residency
+        uint64_t idle_time;
+        uint64_t idle_entries;
+        uint64_t ticks;
+    } stats __attribute__((aligned(CACHE_LINE_SIZE)));
+} __attribute__((aligned(1 << HART_SHIFT)));
+
+extern struct hart harts[MAX_HARTS];
+
+static inline struct hart *this_hart(void) {
+#ifdef __riscv
+    struct hart *h;
+    asm volatile("mv %0, tp" : "=r"(h));
+    return h;
+#else
+    return &harts[0];
+#endif
+}
+
+static inline uint64_t hart_id(void) {
+    return this_hart()->id;
+}
+
+static inline int in_interrupt(void) {
+    return this_hart()->irq_depth != 0;
+}
+
+void hart_init(void *kernel_stack_top);
+void hart_dump_stats(void);
+
+#endif
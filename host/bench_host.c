@@ -0,0 +1,161 @@
+#include "shim.h"
+#include "../fs.h"
+#include "../process.h"
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Microbenchmarks in the shape of google-benchmark: each one runs its
+ * body state->iters times, and the driver doubles iters until a run
+ * takes at least BENCH_MIN_NS, then reports time per iteration. Setup
+ * before bench_begin() is not timed.
+ */
+#define BENCH_MIN_NS 200000000ULL
+
+struct bench_state {
+    uint64_t iters;
+    uint32_t arg;
+    uint64_t start;
+};
+
+struct bench {
+    const char *name;
+    void (*fn)(struct bench_state *st);
+    uint32_t arg;
+};
+
+static void bench_begin(struct bench_state *st) {
+    st->start = host_clock_ns();
+}
+
+// Keeps the compiler from dropping results nobody reads
+static volatile int sink;
+
+static char io_buf[MAX_FILESIZE];
+
+static void bm_fs_open_close(struct bench_state *st) {
+    fs_close(fs_open("/bench", O_CREAT | O_WRONLY));
+    bench_begin(st);
+    for (uint64_t i = 0; i < st->iters; i++) {
+        fs_close(fs_open("/bench", O_RDONLY));
+    }
+}
+
+// Worst case lookup: every other file slot is taken first
+static void bm_fs_open_full_table(struct bench_state *st) {
+    char name[] = "/f00";
+    for (int i = 0; i < MAX_FILES; i++) {
+        name[2] = '0' + i / 10;
+        name[3] = '0' + i % 10;
+        fs_close(fs_open(name, O_CREAT | O_WRONLY));
+    }
+    bench_begin(st);
+    for (uint64_t i = 0; i < st->iters; i++) {
+        fs_close(fs_open(name, O_RDONLY));
+    }
+}
+
+static void bm_fs_write(struct bench_state *st) {
+    int fd = fs_open("/bench", O_CREAT | O_WRONLY);
+    bench_begin(st);
+    for (uint64_t i = 0; i < st->iters; i++) {
+        // Rewind without reopening; there is no lseek
+        fd_table[fd].offset = 0;
+        sink = fs_write(fd, io_buf, st->arg);
+    }
+    fs_close(fd);
+}
+
+static void bm_fs_read(struct bench_state *st) {
+    int fd = fs_open("/bench", O_CREAT | O_RDWR);
+    fs_write(fd, io_buf, MAX_FILESIZE);
+    bench_begin(st);
+    for (uint64_t i = 0; i < st->iters; i++) {
+        fd_table[fd].offset = 0;
+        sink = fs_read(fd, io_buf, st->arg);
+    }
+    fs_close(fd);
+}
+
+static void idle_entry(void) {
+}
+
+// arg processes share the run queue with init
+static void bm_process_yield(struct bench_state *st) {
+    for (uint32_t i = 0; i < st->arg; i++) {
+        process_create("y", idle_entry);
+    }
+    bench_begin(st);
+    for (uint64_t i = 0; i < st->iters; i++) {
+        process_yield();
+    }
+}
+
+static void bm_process_block_wake(struct bench_state *st) {
+    process_t *init = process_current();
+    process_create("w", idle_entry);
+    bench_begin(st);
+    for (uint64_t i = 0; i < st->iters; i++) {
+        process_block();
+        process_wake(init, 0);
+        process_yield();
+    }
+}
+
+static void bm_process_create_reap(struct bench_state *st) {
+    bench_begin(st);
+    for (uint64_t i = 0; i < st->iters; i++) {
+        int pid = process_create("c", idle_entry);
+        process_terminate(process_get(pid), 0);
+        sink = process_wait(0);
+    }
+}
+
+static const struct bench benches[] = {
+    { "fs_open_close",         bm_fs_open_close,       0 },
+    { "fs_open_full_table",    bm_fs_open_full_table,  0 },
+    { "fs_write",              bm_fs_write,            64 },
+    { "fs_write",              bm_fs_write,            512 },
+    { "fs_write",              bm_fs_write,            4096 },
+    { "fs_read",               bm_fs_read,             64 },
+    { "fs_read",               bm_fs_read,             512 },
+    { "fs_read",               bm_fs_read,             4096 },
+    { "process_yield",         bm_process_yield,       1 },
+    { "process_yield",         bm_process_yield,       16 },
+    { "process_yield",         bm_process_yield,       63 },
+    { "process_block_wake",    bm_process_block_wake,  0 },
+    { "process_create_reap",   bm_process_create_reap, 0 },
+};
+
+// Usage: host_bench [substring]
+int main(int argc, char **argv) {
+    const char *filter = argc > 1 ? argv[1] : NULL;
+    
+    printf("%-28s %12s %14s\n", "Benchmark", "Time", "Iterations");
+    printf("------------------------------------------------------------\n");
+    
+    for (size_t b = 0; b < sizeof(benches) / sizeof(benches[0]); b++) {
+        const struct bench *bm = &benches[b];
+        char name[64];
+        if (bm->arg) {
+            snprintf(name, sizeof(name), "%s/%u", bm->name, bm->arg);
+        } else {
+            snprintf(name, sizeof(name), "%s", bm->name);
+        }
+        if (filter && !strstr(name, filter)) continue;
+        
+        struct bench_state st = { 1, bm->arg, 0 };
+        uint64_t elapsed;
+        for (;;) {
+            shim_reset();
+            bm->fn(&st);
+            elapsed = host_clock_ns() - st.start;
+            if (elapsed >= BENCH_MIN_NS || st.iters >= (1ULL << 32)) break;
+            st.iters *= 2;
+        }
+        
+        printf("%-28s %9.1f ns %14llu\n", name, (double)elapsed / st.iters,
+               (unsigned long long)st.iters);
+    }
+    return 0;
+}
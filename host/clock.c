@@ -0,0 +1,9 @@
+#include "shim.h"
+#include <time.h>
+
+// Separate from shim.c: the kernel's timer.h has its own struct timespec
+uint64_t host_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
@@ -0,0 +1,88 @@
+#include "shim.h"
+#include "../fs.h"
+#include "../epoll.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * libFuzzer harness: each input is a sequence of fs calls, 4 bytes per
+ * op (opcode, two operands, length). Paths come from a small fixed set
+ * so the fuzzer keeps hitting the same files through several fds. The
+ * invariants below trap on anything the sanitizers wouldn't catch.
+ */
+static const char *const paths[] = { "/a", "/b", "/tmp/c", "/a/very/long/path/name" };
+
+static const int open_flags[] = {
+    O_RDONLY, O_WRONLY, O_RDWR, O_CREAT | O_WRONLY, O_CREAT | O_RDWR,
+    O_TRUNC | O_WRONLY, O_CREAT | O_TRUNC | O_RDWR, O_TRUNC | O_RDONLY,
+};
+
+static uint8_t io_buf[MAX_FILESIZE * 2];
+
+static void check_invariants(void) {
+    for (int i = 0; i < MAX_FILES; i++) {
+        if (file_table[i].in_use && file_table[i].size > MAX_FILESIZE) abort();
+    }
+    for (int i = 0; i < MAX_FDS; i++) {
+        if (!fd_table[i].in_use || fd_table[i].type != FD_FILE) continue;
+        if (fd_table[i].offset > MAX_FILESIZE) abort();
+        if (!file_table[fd_table[i].file_idx].in_use) abort();
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    static int initialized;
+    if (!initialized) {
+        // Lengths index into io_buf, so keep the pattern recognisable
+        for (size_t i = 0; i < sizeof(io_buf); i++) io_buf[i] = (uint8_t)i;
+        initialized = 1;
+    }
+    shim_reset();
+    
+    for (size_t pos = 0; pos + 4 <= size; pos += 4) {
+        uint8_t op = data[pos] % 7;
+        uint8_t a = data[pos + 1];
+        uint8_t b = data[pos + 2];
+        // Lengths up to twice the file limit, and now and then huge
+        uint32_t len = (uint32_t)data[pos + 3] * 33;
+        if (data[pos + 3] == 0xff) len = 0xffffffffU - b;
+        int fd = a % (MAX_FDS + 2) - 1;
+        int ret;
+        
+        switch (op) {
+            case 0:
+                ret = fs_open(paths[a % 4], open_flags[b % 8]);
+                if (ret >= MAX_FDS) abort();
+                break;
+            case 1:
+                fs_close(fd);
+                break;
+            case 2:
+                // The console would block for input on the host
+                if (fd == STDIN_FD) break;
+                ret = fs_read(fd, io_buf, len > sizeof(io_buf) ? sizeof(io_buf) : len);
+                if (ret > MAX_FILESIZE) abort();
+                break;
+            case 3:
+                if (fd <= STDERR_FD) break;
+                // A huge len exercises the size clamp; it never copies past the file end
+                ret = fs_write(fd, io_buf, len);
+                if (ret > MAX_FILESIZE) abort();
+                break;
+            case 4:
+                fs_poll(fd);
+                break;
+            case 5:
+                epoll_create();
+                break;
+            case 6: {
+                struct epoll_event ev = { b & 1 ? EPOLLIN : EPOLLIN | EPOLLET, b };
+                epoll_ctl(fd, 1 + b % 3, a % MAX_FDS, &ev);
+                break;
+            }
+        }
+        check_invariants();
+    }
+    return 0;
+}
@@ -0,0 +1,52 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Stand-in for libFuzzer's main when the compiler has no -fsanitize=fuzzer
+ * (GCC): replays the files named on the command line, or with none, a
+ * fixed number of pseudo-random inputs so CTest can smoke-run the harness.
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+#define REPLAY_RUNS 2000
+#define REPLAY_MAX  512
+
+static int replay_file(const char *path) {
+    static uint8_t buf[1 << 16];
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+    size_t n = fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+    LLVMFuzzerTestOneInput(buf, n);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        int err = 0;
+        for (int i = 1; i < argc; i++) {
+            err |= replay_file(argv[i]);
+        }
+        return err;
+    }
+    
+    static uint8_t buf[REPLAY_MAX];
+    uint64_t x = 0x9e3779b97f4a7c15ULL;
+    for (int run = 0; run < REPLAY_RUNS; run++) {
+        size_t n = run % REPLAY_MAX;
+        for (size_t i = 0; i < n; i++) {
+            // xorshift64
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            buf[i] = (uint8_t)x;
+        }
+        LLVMFuzzerTestOneInput(buf, n);
+    }
+    printf("fuzz_fs: %d random inputs ok\n", REPLAY_RUNS);
+    return 0;
+}
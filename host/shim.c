@@ -0,0 +1,185 @@
+#include "shim.h"
+#include "../printk.h"
+#include "../process.h"
+#include "../fs.h"
+#include "../hart.h"
+#include "../trap.h"
+#include "../vdso.h"
+#include "../uart.h"
+#include "../riscv.h"
+#include "../perf.h"
+#include "../trace.h"
+#include "../shm.h"
+#include "../tick.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+// No <stdlib.h>: it drags in a struct timespec that clashes with timer.h
+
+uint64_t shim_now;
+int shim_verbose;
+
+char shim_console[4096];
+uint32_t shim_console_len;
+
+static uint64_t shim_deadline = UINT64_MAX;
+
+struct hart harts[MAX_HARTS];
+struct vdso_data vdso_page;
+uint8_t log_levels[LOG_NR_SUBSYS] = { [0 ... LOG_NR_SUBSYS - 1] = LOG_DEBUG };
+
+// printk's format subset is printf's, so the host libc does the work
+void printk(const char *fmt, ...) {
+    if (!shim_verbose) return;
+    
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+}
+
+void printk_flush(void) {
+}
+
+uint64_t read_cycle(void) {
+    return host_clock_ns();
+}
+
+uint64_t read_time(void) {
+    return shim_now;
+}
+
+uint64_t irq_save(void) {
+    return 0;
+}
+
+void irq_restore(uint64_t flags) {
+    (void)flags;
+}
+
+void trap_set_timer(uint64_t deadline) {
+    shim_deadline = deadline;
+}
+
+/*
+ * The only interrupt a host process can wait for is a timer, so idling
+ * jumps the clock to the next deadline. Nothing armed means the test
+ * blocked a process nobody will ever wake.
+ */
+void idle_wait(void) {
+    if (shim_deadline == UINT64_MAX) {
+        fprintf(stderr, "shim: pid %d blocked with no timer pending\n",
+                harts[0].current_pid);
+        __builtin_abort();
+    }
+    if (shim_now < shim_deadline) {
+        shim_now = shim_deadline;
+    }
+    shim_deadline = UINT64_MAX;
+    timer_interrupt();
+}
+
+void shim_advance(uint64_t ticks) {
+    uint64_t target = shim_now + ticks;
+    while (shim_deadline <= target) {
+        shim_now = shim_deadline;
+        shim_deadline = UINT64_MAX;
+        timer_interrupt();
+    }
+    shim_now = target;
+}
+
+void entry_a(void) {
+}
+
+// Never entered: nothing on the host returns to user mode
+void signal_trampoline(void) {
+    __builtin_abort();
+}
+
+void thread_trampoline(void) {
+    __builtin_abort();
+}
+
+// Switching needs a real trap, so kthreads can't be scheduled here
+void sched_trap(void) {
+    fprintf(stderr, "shim: kthreads can't run on the host\n");
+    __builtin_abort();
+}
+
+// No PMU on the host: events can't be opened, so there is nothing to switch
+void perf_switch(struct process *prev, struct process *next) {
+    (void)prev; (void)next;
+}
+
+int perf_read(int idx, void *buf, uint32_t count) {
+    (void)idx; (void)buf; (void)count;
+    return -1;
+}
+
+void perf_release(int idx) {
+    (void)idx;
+}
+
+void perf_release_process(int pid) {
+    (void)pid;
+}
+
+void vdso_set_pid(int pid) {
+    vdso_page.pid = pid;
+}
+
+int uart_ready(void) {
+    return 1;
+}
+
+int uart_write(const void *buf, uint32_t count) {
+    uint32_t n = count;
+    if (n > sizeof(shim_console) - shim_console_len) {
+        n = sizeof(shim_console) - shim_console_len;
+    }
+    memcpy(shim_console + shim_console_len, buf, n);
+    shim_console_len += n;
+    return count;
+}
+
+int uart_read(void *buf, uint32_t count) {
+    (void)buf; (void)count;
+    return 0;
+}
+
+uint32_t uart_poll(void) {
+    return POLLOUT;
+}
+
+void shim_reset(void) {
+    static int timer_started;
+    
+    tick_stop();
+    for (int i = 0; i < MAX_FDS; i++) {
+        if (fd_table[i].in_use) {
+            fs_close(i);
+        }
+    }
+    for (int i = 0; i < MAX_PROCESSES; i++) {
+        timer_cancel(&proc_table[i].timeout);
+        timer_cancel(&proc_table[i].dl.timer);
+    }
+    
+    memset(proc_table, 0, sizeof(proc_table));
+    memset(file_table, 0, sizeof(file_table));
+    memset(fd_table, 0, sizeof(fd_table));
+    memset(harts, 0, sizeof(harts));
+    shim_console_len = 0;
+    trace_ctl(TRACE_STOP, 0, 0);
+    
+    vdso_page.timebase_freq = TIMEBASE_FREQ;
+    if (!timer_started) {
+        timer_init();
+        timer_started = 1;
+    }
+    process_init();
+    fs_init();
+    shm_init();
+}
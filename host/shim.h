@@ -0,0 +1,30 @@
+#ifndef HOST_SHIM_H
+#define HOST_SHIM_H
+
+#include <stdint.h>
+
+/*
+ * Host stand-ins for the hardware the kernel modules in host/ touch.
+ * read_time() is a virtual clock that only moves when a test advances
+ * it or when a blocked process idles, so timeouts are deterministic.
+ */
+extern uint64_t shim_now;
+extern int shim_verbose;
+
+// Console bytes the kernel wrote through uart_write
+extern char shim_console[4096];
+extern uint32_t shim_console_len;
+
+// Real monotonic nanoseconds, for read_cycle() and the benchmarks
+uint64_t host_clock_ns(void);
+
+// Wipes the process table, fd and file tables and re-runs their init
+void shim_reset(void);
+
+// Moves the virtual clock forward, running every timer that comes due
+void shim_advance(uint64_t ticks);
+
+// Entry point for test processes; contexts are switched but never run
+void entry_a(void);
+
+#endif
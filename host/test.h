@@ -0,0 +1,46 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdint.h>
+
+/*
+ * Minimal unit-test registry. TEST(name) defines a case that registers
+ * itself before main; the runner resets the kernel state around each
+ * one. A failed CHECK records the location and ends the case.
+ */
+struct test_case {
+    const char *name;
+    const char *file;
+    void (*fn)(void);
+    struct test_case *next;
+};
+
+void test_register(struct test_case *tc);
+void test_fail(const char *file, int line, const char *expr, long long a, long long b);
+
+#define TEST(name)                                                        \
+    static void test_##name(void);                                        \
+    static struct test_case test_case_##name = { #name, __FILE__, test_##name, 0 }; \
+    __attribute__((constructor)) static void test_register_##name(void) { \
+        test_register(&test_case_##name);                                 \
+    }                                                                     \
+    static void test_##name(void)
+
+#define CHECK(cond)                                                       \
+    do {                                                                  \
+        if (!(cond)) {                                                    \
+            test_fail(__FILE__, __LINE__, #cond, 0, 0);                   \
+            return;                                                       \
+        }                                                                 \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                    \
+    do {                                                                  \
+        long long _a = (long long)(a), _b = (long long)(b);               \
+        if (_a != _b) {                                                   \
+            test_fail(__FILE__, __LINE__, #a " == " #b, _a, _b);          \
+            return;                                                       \
+        }                                                                 \
+    } while (0)
+
+#endif
@@ -0,0 +1,124 @@
+#include "test.h"
+#include "shim.h"
+#include "../fs.h"
+#include "../epoll.h"
+#include <string.h>
+
+TEST(fs_console_fds_preopened) {
+    CHECK(fd_table[STDIN_FD].in_use);
+    CHECK_EQ(fd_table[STDOUT_FD].type, FD_CONSOLE);
+    CHECK_EQ(fd_table[STDERR_FD].flags, O_WRONLY);
+    CHECK_EQ(fs_open("/a", O_CREAT | O_RDWR), 3);
+}
+
+TEST(fs_open_missing_without_creat) {
+    CHECK_EQ(fs_open("/missing", O_RDONLY), -1);
+}
+
+TEST(fs_write_read_roundtrip) {
+    int fd = fs_open("/f", O_CREAT | O_WRONLY);
+    CHECK(fd >= 0);
+    CHECK_EQ(fs_write(fd, "hello", 5), 5);
+    CHECK_EQ(fs_close(fd), 0);
+    
+    char buf[16] = { 0 };
+    fd = fs_open("/f", O_RDONLY);
+    CHECK_EQ(fs_read(fd, buf, sizeof(buf)), 5);
+    CHECK(memcmp(buf, "hello", 5) == 0);
+    CHECK_EQ(fs_read(fd, buf, sizeof(buf)), 0);
+}
+
+TEST(fs_access_mode_enforced) {
+    char c = 'x';
+    int ro = fs_open("/m", O_CREAT | O_RDONLY);
+    int wo = fs_open("/m", O_WRONLY);
+    CHECK_EQ(fs_write(ro, &c, 1), -1);
+    CHECK_EQ(fs_read(wo, &c, 1), -1);
+    CHECK_EQ(fs_read(STDOUT_FD, &c, 1), -1);
+}
+
+TEST(fs_trunc_resets_size) {
+    int fd = fs_open("/t", O_CREAT | O_WRONLY);
+    fs_write(fd, "abcdef", 6);
+    fs_close(fd);
+    
+    fd = fs_open("/t", O_TRUNC | O_WRONLY);
+    CHECK(fd >= 0);
+    CHECK_EQ(file_table[fd_table[fd].file_idx].size, 0);
+}
+
+TEST(fs_read_after_foreign_trunc) {
+    char buf[8];
+    int wr = fs_open("/r", O_CREAT | O_RDWR);
+    fs_write(wr, "abcdef", 6);
+    
+    // wr's offset now sits past the end of the truncated file
+    fs_open("/r", O_TRUNC | O_WRONLY);
+    CHECK_EQ(fs_read(wr, buf, sizeof(buf)), 0);
+}
+
+TEST(fs_write_clamped_to_max_size) {
+    static char big[MAX_FILESIZE + 100];
+    int fd = fs_open("/big", O_CREAT | O_WRONLY);
+    CHECK_EQ(fs_write(fd, big, sizeof(big)), MAX_FILESIZE);
+    CHECK_EQ(fs_write(fd, big, 1), 0);
+}
+
+TEST(fs_write_huge_count_does_not_wrap) {
+    // Only MAX_FILESIZE - 2 bytes of src are ever read
+    static char src[MAX_FILESIZE];
+    int fd = fs_open("/w", O_CREAT | O_WRONLY);
+    fs_write(fd, "ab", 2);
+    CHECK_EQ(fs_write(fd, src, 0xffffffffU), MAX_FILESIZE - 2);
+}
+
+TEST(fs_fd_table_exhaustion) {
+    int last = -1;
+    for (int i = 3; i < MAX_FDS; i++) {
+        last = fs_open("/x", O_CREAT | O_RDONLY);
+        CHECK_EQ(last, i);
+    }
+    CHECK_EQ(fs_open("/x", O_RDONLY), -1);
+    CHECK_EQ(fs_close(last), 0);
+    CHECK_EQ(fs_open("/x", O_RDONLY), last);
+}
+
+TEST(fs_close_invalid) {
+    CHECK_EQ(fs_close(-1), -1);
+    CHECK_EQ(fs_close(MAX_FDS), -1);
+    CHECK_EQ(fs_close(10), -1);
+}
+
+TEST(fs_poll_follows_mode) {
+    int ro = fs_open("/p", O_CREAT | O_RDONLY);
+    int rw = fs_open("/p", O_RDWR);
+    CHECK_EQ(fs_poll(ro), POLLIN);
+    CHECK_EQ(fs_poll(rw), POLLIN | POLLOUT);
+    CHECK_EQ(fs_poll(40), POLLERR);
+}
+
+TEST(fs_console_write_reaches_uart) {
+    CHECK_EQ(fs_write(STDOUT_FD, "hi\n", 3), 3);
+    CHECK_EQ(shim_console_len, 3);
+    CHECK(memcmp(shim_console, "hi\n", 3) == 0);
+}
+
+TEST(fs_epoll_sees_file_write) {
+    int ep = epoll_create();
+    int fd = fs_open("/e", O_CREAT | O_RDWR);
+    struct epoll_event ev = { EPOLLIN | EPOLLET, 7 };
+    CHECK(ep >= 0);
+    CHECK_EQ(epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev), 0);
+    
+    struct epoll_event out;
+    fs_write(fd, "z", 1);
+    CHECK_EQ(epoll_wait(ep, &out, 1, 0), 1);
+    CHECK_EQ(out.data, 7);
+    CHECK_EQ(fs_close(ep), 0);
+}
+
+TEST(fs_console_close_leaves_stdio_for_everyone) {
+    CHECK_EQ(fs_close(STDOUT_FD), 0);
+    CHECK(fd_table[STDOUT_FD].in_use);
+    CHECK_EQ(fs_write(STDOUT_FD, "ok", 2), 2);
+}
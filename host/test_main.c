@@ -0,0 +1,54 @@
+#include "test.h"
+#include "shim.h"
+#include <stdio.h>
+#include <string.h>
+
+static struct test_case *tests;
+static struct test_case **tests_tail = &tests;
+static int current_failed;
+
+// Keeps definition order so output follows the source files
+void test_register(struct test_case *tc) {
+    *tests_tail = tc;
+    tests_tail = &tc->next;
+}
+
+void test_fail(const char *file, int line, const char *expr, long long a, long long b) {
+    printf("    %s:%d: CHECK(%s) failed", file, line, expr);
+    if (a != b) {
+        printf(": %lld != %lld", a, b);
+    }
+    printf("\n");
+    current_failed = 1;
+}
+
+// Usage: host_tests [-v] [substring]; -v shows the kernel's printk output
+int main(int argc, char **argv) {
+    const char *filter = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) {
+            shim_verbose = 1;
+        } else {
+            filter = argv[i];
+        }
+    }
+    
+    int passed = 0, failed = 0;
+    for (struct test_case *tc = tests; tc; tc = tc->next) {
+        if (filter && !strstr(tc->name, filter)) continue;
+        
+        shim_reset();
+        current_failed = 0;
+        tc->fn();
+        
+        printf("%s %s\n", current_failed ? "FAIL" : "ok  ", tc->name);
+        if (current_failed) {
+            failed++;
+        } else {
+            passed++;
+        }
+    }
+    
+    printf("\n%d passed, %d failed\n", passed, failed);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,282 @@
+#include "test.h"
+#include "shim.h"
+#include "../process.h"
+#include "../trap.h"
+#include "../hart.h"
+#include "../signal.h"
+#include "../fs.h"
+#include "../vdso.h"
+#include "../riscv.h"
+#include <string.h>
+
+static void entry_b(void) {
+}
+
+TEST(proc_init_is_running) {
+    process_t *init = process_current();
+    CHECK(init != 0);
+    CHECK_EQ(init->pid, 1);
+    CHECK_EQ(init->state, PROC_RUNNING);
+}
+
+TEST(proc_create_is_ready_child) {
+    int pid = process_create("a", entry_a);
+    process_t *p = process_get(pid);
+    CHECK(p != 0);
+    CHECK_EQ(p->state, PROC_READY);
+    CHECK_EQ(p->ppid, 1);
+    CHECK(strcmp(p->name, "a") == 0);
+    CHECK_EQ(p->context.pc, (uint64_t)entry_a);
+    CHECK_EQ(p->context.sp, (uint64_t)(p->stack + STACK_SIZE));
+}
+
+TEST(proc_table_full) {
+    for (int i = 1; i < MAX_PROCESSES; i++) {
+        CHECK(process_create("x", entry_a) > 0);
+    }
+    CHECK_EQ(process_create("x", entry_a), -1);
+}
+
+TEST(proc_yield_round_robin) {
+    int a = process_create("a", entry_a);
+    int b = process_create("b", entry_b);
+    
+    process_yield();
+    CHECK_EQ(process_current()->pid, a);
+    process_yield();
+    CHECK_EQ(process_current()->pid, b);
+    process_yield();
+    CHECK_EQ(process_current()->pid, 1);
+    CHECK_EQ(process_get(a)->state, PROC_READY);
+}
+
+TEST(proc_yield_alone_keeps_running) {
+    process_yield();
+    CHECK_EQ(process_current()->pid, 1);
+    CHECK_EQ(process_current()->state, PROC_RUNNING);
+}
+
+TEST(proc_block_and_wake) {
+    process_t *init = process_current();
+    int a = process_create("a", entry_a);
+    
+    process_block();
+    CHECK_EQ(process_current()->pid, a);
+    CHECK_EQ(init->state, PROC_BLOCKED);
+    
+    process_wake(init, 42);
+    CHECK_EQ(init->state, PROC_READY);
+    process_yield();
+    CHECK_EQ(process_current()->pid, 1);
+    CHECK_EQ(init->context.regs[10], 42);
+}
+
+TEST(proc_wake_ignores_non_blocked) {
+    int a = process_create("a", entry_a);
+    process_wake(process_get(a), 7);
+    CHECK_EQ(process_get(a)->context.regs[10], (uint64_t)&vdso_page);
+}
+
+TEST(proc_terminate_then_wait_reaps) {
+    int status = 0;
+    int a = process_create("a", entry_a);
+    process_terminate(process_get(a), 3);
+    CHECK_EQ(process_get(a)->state, PROC_ZOMBIE);
+    
+    CHECK_EQ(process_wait(&status), a);
+    CHECK_EQ(status, 3);
+    CHECK(process_get(a) == 0);
+    CHECK_EQ(process_wait(&status), -1);
+}
+
+TEST(proc_wait_blocks_until_child_exits) {
+    process_t *init = process_current();
+    int a = process_create("a", entry_a);
+    
+    // Nothing to reap yet: init sleeps and a gets the hart
+    CHECK_EQ(process_wait(0), -1);
+    CHECK_EQ(process_current()->pid, a);
+    CHECK_EQ(init->state, PROC_BLOCKED);
+    
+    process_exit(9);
+    CHECK_EQ(process_current()->pid, 1);
+    CHECK(init->restart);
+    
+    int status = 0;
+    CHECK_EQ(process_wait(&status), a);
+    CHECK_EQ(status, 9);
+}
+
+TEST(proc_sleep_fires_on_deadline) {
+    uint64_t deadline = read_time() + 5000;
+    CHECK_EQ(process_sleep(deadline), 0);
+    CHECK(read_time() >= deadline);
+    CHECK_EQ(process_current()->state, PROC_RUNNING);
+}
+
+TEST(proc_sleep_in_past_returns_at_once) {
+    shim_advance(100);
+    CHECK_EQ(process_sleep(50), 0);
+}
+
+TEST(proc_interrupt_cancels_sleep) {
+    process_t *init = process_current();
+    int a = process_create("a", entry_a);
+    
+    timer_add(&init->timeout, read_time() + 1000, 0, init);
+    process_block();
+    CHECK_EQ(process_current()->pid, a);
+    
+    process_interrupt(init);
+    CHECK(!timer_pending(&init->timeout));
+    CHECK_EQ(init->state, PROC_READY);
+    CHECK_EQ((int64_t)init->context.regs[10], -1);
+}
+
+TEST(proc_switch_frame_swaps_context) {
+    struct trap_frame tf = { 0 };
+    int a = process_create("a", entry_a);
+    tf.sepc = 0x1000;
+    tf.x2 = 0x2000;
+    
+    process_yield();
+    CHECK(process_switch_pending());
+    process_switch_frame(&tf);
+    
+    CHECK(!process_switch_pending());
+    CHECK_EQ(tf.sepc, (uint64_t)entry_a);
+    CHECK_EQ(tf.x10, (uint64_t)&vdso_page);
+    CHECK_EQ(process_get(1)->context.pc, 0x1000);
+    CHECK_EQ(process_get(1)->context.sp, 0x2000);
+    CHECK_EQ(harts[0].running_pid, a);
+}
+
+TEST(proc_kill_probe_and_missing) {
+    CHECK_EQ(process_kill(1, 0), 0);
+    CHECK_EQ(process_kill(999, 0), -1);
+}
+
+TEST(proc_fault_signal_overrides_ignore_and_mask) {
+    process_t *init = process_current();
+    struct sigaction ign = { .sa_handler = SIG_IGN };
+    CHECK_EQ(signal_action(SIGSEGV, &ign, 0), 0);
+    init->sig_blocked = SIGMASK(SIGILL);
+    
+    signal_send(init, SIGSEGV);
+    CHECK(!signal_work_pending(init));
+    CHECK_EQ(signal_force(init, SIGSEGV), 0);
+    CHECK_EQ(signal_force(init, SIGILL), 0);
+    CHECK_EQ(init->sigactions[SIGSEGV].sa_handler, SIG_DFL);
+    CHECK_EQ(init->sig_blocked, 0);
+    CHECK_EQ(init->sig_pending, SIGMASK(SIGSEGV) | SIGMASK(SIGILL));
+}
+
+static uint8_t thread_stack[1024] __attribute__((aligned(16)));
+extern void thread_trampoline(void);
+
+static void thread_fn(void *arg) {
+    (void)arg;
+}
+
+static int clone_thread(uint64_t extra, uint32_t *ctid) {
+    return process_clone(CLONE_VM | CLONE_FILES | CLONE_THREAD | extra, thread_fn,
+                         thread_stack + sizeof(thread_stack), (void *)0x55, (void *)0x1234, ctid);
+}
+
+TEST(proc_clone_thread_joins_group) {
+    int tid = clone_thread(CLONE_SETTLS, 0);
+    process_t *t = process_get(tid);
+    CHECK(t != 0);
+    CHECK(tid != 1);
+    CHECK_EQ(t->tgid, 1);
+    CHECK_EQ(t->ppid, 0);
+    CHECK_EQ(t->state, PROC_READY);
+    CHECK_EQ(t->context.pc, (uint64_t)thread_fn);
+    CHECK_EQ(t->context.sp, (uint64_t)(thread_stack + sizeof(thread_stack)));
+    CHECK_EQ(t->context.regs[1], (uint64_t)thread_trampoline);
+    CHECK_EQ(t->context.regs[4], 0x1234);
+    CHECK_EQ(t->context.regs[10], 0x55);
+}
+
+TEST(proc_clone_without_thread_is_child) {
+    int pid = process_clone(CLONE_VM, thread_fn, thread_stack + sizeof(thread_stack), 0, 0, 0);
+    CHECK_EQ(process_get(pid)->tgid, pid);
+    CHECK_EQ(process_get(pid)->ppid, 1);
+    CHECK_EQ(process_clone(CLONE_THREAD, thread_fn, thread_stack + 8, 0, 0, 0), -1);
+}
+
+TEST(proc_thread_exit_clears_tid) {
+    uint32_t ctid = 77;
+    int tid = clone_thread(CLONE_CHILD_CLEARTID, &ctid);
+    process_terminate(process_get(tid), 0);
+    CHECK_EQ(ctid, 0);
+    CHECK_EQ(process_get(tid)->state, PROC_ZOMBIE);
+    // Nobody reaps a thread, and its slot is free again
+    CHECK_EQ(process_wait(0), -1);
+    for (int i = 1; i < MAX_PROCESSES; i++) {
+        CHECK(process_create("x", entry_a) > 0);
+    }
+}
+
+TEST(proc_wait_holds_leader_until_group_exits) {
+    int a = process_create("a", entry_a);
+    process_yield();
+    CHECK_EQ(process_current()->pid, a);
+    int t = clone_thread(0, 0);
+    CHECK_EQ(process_get(t)->tgid, a);
+    CHECK_EQ(process_get(t)->ppid, 1);
+    process_exit(5);
+    
+    // a is a zombie but t still runs, so init has to block
+    CHECK_EQ(process_current()->pid, 1);
+    CHECK_EQ(process_wait(0), -1);
+    CHECK_EQ(process_current()->pid, t);
+    process_exit(0);
+    CHECK(process_get(1)->restart);
+    
+    int status = 0;
+    CHECK_EQ(process_wait(&status), a);
+    CHECK_EQ(status, 5);
+}
+
+TEST(proc_exit_group_takes_every_thread) {
+    int t1 = clone_thread(0, 0);
+    int t2 = clone_thread(0, 0);
+    int other = process_create("o", entry_a);
+    process_terminate_group(process_get(t1), 9);
+    CHECK_EQ(process_get(1)->state, PROC_ZOMBIE);
+    CHECK_EQ(process_get(1)->exit_code, 9);
+    CHECK_EQ(process_get(t2)->state, PROC_ZOMBIE);
+    CHECK(process_get(other)->state != PROC_ZOMBIE);
+}
+
+TEST(proc_kthread_frame_is_supervisor) {
+    struct trap_frame tf = { 0 };
+    int k = kthread_create("k", thread_fn, (void *)0x77);
+    process_yield();
+    process_switch_frame(&tf);
+    
+    CHECK_EQ(harts[0].running_pid, k);
+    CHECK(tf.sstatus & SSTATUS_SPP);
+    CHECK(tf.sstatus & SSTATUS_SPIE);
+    CHECK_EQ(tf.x4, (uint64_t)&harts[0]);
+    CHECK_EQ(tf.x10, (uint64_t)thread_fn);
+    CHECK_EQ(tf.x11, 0x77);
+    CHECK_EQ(process_kill(k, 0), -1);
+}
+
+TEST(proc_kthread_wake_jumps_the_queue) {
+    int k = kthread_create("k", thread_fn, 0);
+    int a = process_create("a", entry_a);
+    process_yield();
+    kthread_prepare_park();
+    process_yield();
+    CHECK_EQ(process_current()->pid, a);
+    
+    // Ahead of init, which has been queued since the first yield
+    kthread_wake(process_get(k));
+    process_yield();
+    CHECK_EQ(process_current()->pid, k);
+    process_yield();
+    CHECK_EQ(process_current()->pid, 1);
+}
@@ -0,0 +1,157 @@
+#include "test.h"
+#include "shim.h"
+#include "../process.h"
+#include "../timer.h"
+#include "../hart.h"
+#include "../riscv.h"
+
+#define MS 1000000ULL
+
+static int set_deadline(int pid, uint64_t runtime, uint64_t deadline, uint64_t period) {
+    struct sched_attr attr = {
+        .size = sizeof(attr),
+        .sched_policy = SCHED_DEADLINE,
+        .sched_runtime = runtime,
+        .sched_deadline = deadline,
+        .sched_period = period,
+    };
+    return process_sched_setattr(pid, &attr);
+}
+
+TEST(sched_admission_control) {
+    int a = process_create("a", entry_a);
+    int b = process_create("b", entry_a);
+    CHECK_EQ(set_deadline(a, 5 * MS, 10 * MS, 0), 0);
+    CHECK_EQ(set_deadline(b, 5 * MS, 10 * MS, 0), -1);
+    CHECK_EQ(set_deadline(b, 4 * MS, 10 * MS, 20 * MS), 0);
+    CHECK_EQ(set_deadline(b, 11 * MS, 10 * MS, 0), -1);
+    CHECK_EQ(set_deadline(b, 2 * MS, 10 * MS, 5 * MS), -1);
+    
+    struct sched_attr attr;
+    CHECK_EQ(process_sched_getattr(b, &attr), 0);
+    CHECK_EQ(attr.sched_policy, SCHED_DEADLINE);
+    CHECK_EQ(attr.sched_runtime, 4 * MS);
+    CHECK_EQ(attr.sched_period, 20 * MS);
+    
+    // Leaving the class, or exiting, hands the bandwidth back
+    struct sched_attr normal = { .size = sizeof(normal), .sched_policy = SCHED_NORMAL };
+    CHECK_EQ(set_deadline(1, 6 * MS, 10 * MS, 0), -1);
+    CHECK_EQ(process_sched_setattr(a, &normal), 0);
+    process_terminate(process_get(b), 0);
+    CHECK_EQ(set_deadline(1, 9 * MS, 10 * MS, 0), 0);
+}
+
+TEST(sched_earliest_deadline_runs_first) {
+    int a = process_create("a", entry_a);
+    int b = process_create("b", entry_a);
+    int c = process_create("c", entry_a);
+    CHECK_EQ(set_deadline(c, 1 * MS, 20 * MS, 0), 0);
+    CHECK_EQ(set_deadline(b, 1 * MS, 10 * MS, 0), 0);
+    CHECK_EQ(this_hart()->need_resched, 1);
+    
+    process_yield();
+    CHECK_EQ(process_current()->pid, b);
+    process_terminate(process_current(), 0);
+    CHECK_EQ(process_current()->pid, c);
+    process_terminate(process_current(), 0);
+    CHECK_EQ(process_current()->pid, a);
+}
+
+TEST(sched_budget_overrun_throttles_until_next_period) {
+    int a = process_create("a", entry_a);
+    CHECK_EQ(set_deadline(a, 1 * MS, 10 * MS, 0), 0);
+    process_yield();
+    CHECK_EQ(process_current()->pid, a);
+    
+    process_t *p = process_current();
+    shim_advance(timer_ns_to_ticks(1 * MS));
+    CHECK_EQ(process_current()->pid, 1);
+    CHECK(p->dl.throttled);
+    CHECK_EQ(p->dl.overruns, 1);
+    
+    // The unfinished job is late by the time the next period starts
+    shim_advance(timer_ns_to_ticks(9 * MS));
+    CHECK_EQ(process_current()->pid, a);
+    CHECK(!p->dl.throttled);
+    CHECK_EQ(p->dl.misses, 1);
+    CHECK_EQ(p->dl.budget, timer_ns_to_ticks(1 * MS));
+}
+
+TEST(sched_yield_ends_job_on_time) {
+    int a = process_create("a", entry_a);
+    CHECK_EQ(set_deadline(a, 2 * MS, 10 * MS, 0), 0);
+    process_yield();
+    process_t *p = process_current();
+    CHECK_EQ(p->pid, a);
+    
+    shim_advance(timer_ns_to_ticks(1 * MS));
+    process_sched_yield();
+    CHECK_EQ(process_current()->pid, 1);
+    CHECK(p->dl.throttled);
+    
+    shim_advance(timer_ns_to_ticks(9 * MS));
+    CHECK_EQ(process_current()->pid, a);
+    CHECK_EQ(p->dl.misses, 0);
+    CHECK_EQ(p->dl.overruns, 0);
+}
+
+TEST(sched_cbs_wakeup_rule) {
+    int a = process_create("a", entry_a);
+    CHECK_EQ(set_deadline(a, 2 * MS, 10 * MS, 0), 0);
+    process_yield();
+    process_t *p = process_current();
+    uint64_t deadline = p->dl.abs_deadline;
+    
+    // Half the budget left with 8 of 10ms to go: keeps its deadline
+    shim_advance(timer_ns_to_ticks(1 * MS));
+    process_block();
+    shim_advance(timer_ns_to_ticks(1 * MS));
+    process_wake(p, 0);
+    CHECK_EQ(p->dl.abs_deadline, deadline);
+    CHECK_EQ(p->dl.budget, timer_ns_to_ticks(1 * MS));
+    CHECK_EQ(this_hart()->need_resched, 1);
+    
+    // The same budget with 1ms to go would overrun the bandwidth
+    process_yield();
+    CHECK_EQ(process_current()->pid, a);
+    process_block();
+    shim_advance(timer_ns_to_ticks(7 * MS));
+    process_wake(p, 0);
+    CHECK_EQ(p->dl.abs_deadline, read_time() + timer_ns_to_ticks(10 * MS));
+    CHECK_EQ(p->dl.budget, timer_ns_to_ticks(2 * MS));
+}
+
+TEST(sched_yield_idles_until_next_period) {
+    CHECK_EQ(set_deadline(0, 1 * MS, 10 * MS, 0), 0);
+    process_yield();
+    uint64_t start = read_time();
+    
+    // Nothing else is ready, so the hart sleeps through the throttle
+    process_sched_yield();
+    CHECK_EQ(process_current()->pid, 1);
+    CHECK_EQ(read_time() - start, timer_ns_to_ticks(10 * MS));
+    CHECK(!process_current()->dl.throttled);
+    CHECK_EQ(process_current()->dl.misses, 0);
+}
+
+TEST(sched_lone_task_overruns_every_period) {
+    CHECK_EQ(set_deadline(0, 1 * MS, 10 * MS, 0), 0);
+    process_yield();
+    process_t *p = process_current();
+    uint64_t start = read_time();
+    
+    // Throttled with nothing else to run, so it keeps the hart
+    shim_advance(timer_ns_to_ticks(1 * MS));
+    CHECK_EQ(process_current(), p);
+    CHECK(p->dl.throttled);
+    CHECK_EQ(p->dl.overruns, 1);
+    
+    // The next period has to arm the budget again, or this runs unchecked
+    shim_advance(start + timer_ns_to_ticks(10 * MS) - read_time());
+    CHECK(!p->dl.throttled);
+    CHECK(p->dl.on_cpu);
+    shim_advance(timer_ns_to_ticks(1 * MS));
+    CHECK(p->dl.throttled);
+    CHECK_EQ(p->dl.overruns, 2);
+    CHECK_EQ(p->dl.misses, 1);
+}
@@ -0,0 +1,103 @@
+#include "test.h"
+#include "shim.h"
+#include "../shm.h"
+#include "../fs.h"
+#include "../process.h"
+#include <stdint.h>
+
+#define FRAME (2 * SHM_PAGE_SIZE)
+
+// Only succeeds while every page of the pool is free
+static int pool_empty(void) {
+    int fd = shm_open("/probe", O_CREAT | O_EXCL | O_RDWR);
+    int ok = fd >= 0 && shm_truncate(fd, (uint64_t)SHM_POOL_PAGES * SHM_PAGE_SIZE) == 0;
+    shm_unlink("/probe");
+    fs_close(fd);
+    return ok;
+}
+
+static uint64_t map(int fd, int prot) {
+    return shm_mmap(0, FRAME, prot, MAP_SHARED, fd, 0);
+}
+
+TEST(shm_open_create_and_excl) {
+    CHECK_EQ(shm_open("/f", O_RDWR), -1);
+    int fd = shm_open("/f", O_CREAT | O_EXCL | O_RDWR);
+    CHECK(fd >= 0);
+    CHECK_EQ(fd_table[fd].type, FD_SHM);
+    CHECK_EQ(shm_open("/f", O_CREAT | O_EXCL | O_RDWR), -1);
+    
+    int again = shm_open("/f", O_RDONLY);
+    CHECK(again >= 0 && again != fd);
+    CHECK_EQ(shm_unlink("/f"), 0);
+    CHECK_EQ(shm_unlink("/f"), -1);
+    CHECK_EQ(shm_open("/f", O_RDONLY), -1);
+}
+
+TEST(shm_mappings_share_pages) {
+    int fd = shm_open("/f", O_CREAT | O_RDWR);
+    CHECK_EQ(map(fd, PROT_READ), MAP_FAILED);
+    CHECK_EQ(shm_truncate(fd, FRAME), 0);
+    
+    uint64_t w = map(fd, PROT_READ | PROT_WRITE);
+    CHECK(w != MAP_FAILED);
+    CHECK_EQ(w % SHM_PAGE_SIZE, 0);
+    CHECK_EQ(((uint8_t *)w)[FRAME - 1], 0);
+    ((uint8_t *)w)[FRAME - 1] = 0x5a;
+    
+    int ro = shm_open("/f", O_RDONLY);
+    CHECK_EQ(map(ro, PROT_READ | PROT_WRITE), MAP_FAILED);
+    CHECK_EQ(shm_truncate(ro, FRAME), -1);
+    uint64_t r = map(ro, PROT_READ);
+    CHECK_EQ(r, w);
+    CHECK_EQ(((uint8_t *)r)[FRAME - 1], 0x5a);
+    
+    CHECK_EQ(shm_mmap(w + 1, FRAME, PROT_READ, MAP_SHARED | MAP_FIXED, ro, 0), MAP_FAILED);
+    CHECK_EQ(shm_mmap(0, SHM_PAGE_SIZE, PROT_READ, MAP_SHARED, ro, SHM_PAGE_SIZE),
+             w + SHM_PAGE_SIZE);
+    CHECK_EQ(shm_munmap(w, FRAME + SHM_PAGE_SIZE), -1);
+    CHECK_EQ(shm_munmap(w, FRAME), 0);
+}
+
+TEST(shm_pages_outlive_name_and_fds) {
+    int fd = shm_open("/f", O_CREAT | O_RDWR);
+    CHECK_EQ(shm_truncate(fd, FRAME), 0);
+    uint64_t r = map(fd, PROT_READ);
+    CHECK_EQ(shm_unlink("/f"), 0);
+    CHECK_EQ(fs_close(fd), 0);
+    
+    CHECK(!pool_empty());
+    CHECK_EQ(shm_munmap(r, FRAME), 0);
+    CHECK(pool_empty());
+}
+
+TEST(shm_seal_write_makes_read_only) {
+    int fd = shm_open("/f", O_CREAT | O_RDWR);
+    CHECK_EQ(shm_truncate(fd, FRAME), 0);
+    uint64_t w = map(fd, PROT_READ | PROT_WRITE);
+    
+    CHECK_EQ(shm_fcntl(fd, F_ADD_SEALS, F_SEAL_WRITE), -1);
+    CHECK_EQ(shm_munmap(w, FRAME), 0);
+    CHECK_EQ(shm_fcntl(fd, F_ADD_SEALS, F_SEAL_WRITE | F_SEAL_SHRINK | F_SEAL_SEAL), 0);
+    CHECK_EQ(shm_fcntl(fd, F_GET_SEALS, 0), F_SEAL_WRITE | F_SEAL_SHRINK | F_SEAL_SEAL);
+    
+    CHECK_EQ(map(fd, PROT_READ | PROT_WRITE), MAP_FAILED);
+    CHECK_EQ(map(fd, PROT_READ), w);
+    CHECK_EQ(shm_truncate(fd, SHM_PAGE_SIZE), -1);
+    CHECK_EQ(shm_fcntl(fd, F_ADD_SEALS, F_SEAL_GROW), -1);
+}
+
+TEST(shm_group_exit_drops_mappings) {
+    int fd = shm_open("/f", O_CREAT | O_RDWR);
+    CHECK_EQ(shm_truncate(fd, FRAME), 0);
+    shm_unlink("/f");
+    int a = process_create("a", entry_a);
+    
+    process_yield();
+    CHECK_EQ(process_current()->pid, a);
+    CHECK(map(fd, PROT_READ) != MAP_FAILED);
+    fs_close(fd);
+    process_terminate(process_current(), 0);
+    CHECK_EQ(process_current()->pid, 1);
+    CHECK(pool_empty());
+}
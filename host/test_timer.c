@@ -0,0 +1,87 @@
+#include "test.h"
+#include "shim.h"
+#include "../timer.h"
+#include "../tick.h"
+#include "../process.h"
+#include "../hart.h"
+#include "../riscv.h"
+
+static uint64_t base;
+static uint64_t fired_at[3];
+
+static void record(struct timer *t) {
+    fired_at[(uintptr_t)t->arg] = read_time() - base;
+}
+
+TEST(timer_without_slack_fires_on_time) {
+    struct timer t = { 0 };
+    base = shim_now;
+    fired_at[0] = 0;
+    timer_add(&t, base + 1000, record, (void *)0);
+    shim_advance(5000);
+    CHECK_EQ(fired_at[0], 1000);
+}
+
+TEST(timer_slack_coalesces_wakeups) {
+    struct timer a = { 0 }, b = { 0 }, c = { 0 };
+    base = shim_now;
+    for (int i = 0; i < 3; i++) {
+        fired_at[i] = 0;
+    }
+    // b's window closes first and takes a along; c is not due yet
+    timer_add_slack(&a, base + 1000, 3000, record, (void *)0);
+    timer_add_slack(&b, base + 1500, 500, record, (void *)1);
+    timer_add_slack(&c, base + 2500, 0, record, (void *)2);
+    shim_advance(10000);
+    CHECK_EQ(fired_at[0], 2000);
+    CHECK_EQ(fired_at[1], 2000);
+    CHECK_EQ(fired_at[2], 2500);
+}
+
+TEST(timer_next_deadline_spans_levels) {
+    struct timer a = { 0 }, b = { 0 }, c = { 0 };
+    base = shim_now;
+    for (int i = 0; i < 3; i++) {
+        fired_at[i] = 0;
+    }
+    // a sits in the nearest slot but its window outlasts b, a level up
+    timer_add_slack(&a, base + 2000, 200000, record, (void *)0);
+    timer_add(&b, base + 100000, record, (void *)1);
+    timer_add(&c, base + 500, record, (void *)2);
+    shim_advance(300000);
+    CHECK_EQ(fired_at[2], 500);
+    CHECK_EQ(fired_at[1], 100000);
+    CHECK_EQ(fired_at[0], 100000);
+}
+
+TEST(tick_rotates_run_queue) {
+    int a = process_create("a", entry_a);
+    tick_start();
+    uint64_t period = timer_ns_to_ticks(NSEC_PER_SEC / CONFIG_HZ);
+    
+    shim_advance(period);
+    CHECK_EQ(process_current()->pid, a);
+    shim_advance(period);
+    CHECK_EQ(process_current()->pid, 1);
+    CHECK_EQ(harts[0].stats.ticks, 2);
+    tick_stop();
+}
+
+TEST(tick_stops_while_idle) {
+    uint64_t period = timer_ns_to_ticks(NSEC_PER_SEC / CONFIG_HZ);
+    process_current()->timer_slack = 0;
+    tick_start();
+    
+    // Sleeping ten periods must not take a single tick
+    uint64_t start = shim_now;
+    CHECK_EQ(process_sleep(start + 10 * period), 0);
+    CHECK_EQ(shim_now - start, 10 * period);
+    CHECK_EQ(harts[0].stats.ticks, 0);
+    CHECK_EQ(harts[0].stats.idle_entries, 1);
+    CHECK_EQ(harts[0].stats.idle_time, 10 * period);
+    
+    // The tick is back a full period after the wakeup
+    shim_advance(period);
+    CHECK_EQ(harts[0].stats.ticks, 1);
+    tick_stop();
+}
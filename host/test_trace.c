@@ -0,0 +1,61 @@
+#include "test.h"
+#include "shim.h"
+#include "../trace.h"
+#include "../fs.h"
+#include "../process.h"
+
+static struct trace_record records[TRACE_RECORDS];
+
+static int drain(void) {
+    return trace_ctl(TRACE_READ, TRACE_RECORDS, records);
+}
+
+TEST(trace_off_records_nothing) {
+    int fd = fs_open("/t", O_CREAT | O_RDWR);
+    CHECK(fd >= 0);
+    CHECK_EQ(fs_write(fd, "x", 1), 1);
+    CHECK_EQ(drain(), 0);
+}
+
+TEST(trace_fs_events_in_order) {
+    CHECK_EQ(trace_ctl(TRACE_START, TRACE_CLASS_FS, 0), 0);
+    shim_now = 100;
+    int fd = fs_open("/t", O_CREAT | O_RDWR);
+    CHECK_EQ(fs_write(fd, "abc", 3), 3);
+    CHECK_EQ(fs_read(fd, records, 8), 0);
+    
+    CHECK_EQ(drain(), 3);
+    CHECK_EQ(records[0].event, TRACE_FS_OPEN);
+    CHECK_EQ(records[0].args[0], (uint64_t)fd);
+    CHECK_EQ(records[0].time, 100);
+    CHECK_EQ(records[1].event, TRACE_FS_WRITE);
+    CHECK_EQ(records[1].args[1], 3);
+    CHECK_EQ(records[2].event, TRACE_FS_READ);
+    CHECK_EQ(records[2].args[1], 8);
+    CHECK_EQ(records[2].pid, 1);
+    CHECK_EQ(drain(), 0);
+}
+
+TEST(trace_class_mask_filters) {
+    CHECK_EQ(trace_ctl(TRACE_START, TRACE_CLASS_PROC, 0), 0);
+    int fd = fs_open("/t", O_CREAT | O_RDWR);
+    int pid = process_create("a", entry_a);
+    CHECK(fd >= 0 && pid > 0);
+    
+    CHECK_EQ(drain(), 1);
+    CHECK_EQ(records[0].event, TRACE_PROC_CREATE);
+    CHECK_EQ(records[0].args[0], (uint64_t)pid);
+    CHECK_EQ(records[0].args[1], 1);
+}
+
+TEST(trace_full_buffer_drops_newest) {
+    CHECK_EQ(trace_ctl(TRACE_START, 0, 0), 0);
+    for (int i = 0; i < TRACE_RECORDS + 5; i++) {
+        trace(TRACE_SYSCALL_ENTER, i, 0);
+    }
+    CHECK_EQ(trace_ctl(TRACE_STOP, 0, 0), 0);
+    trace(TRACE_SYSCALL_ENTER, 0, 0);
+    
+    CHECK_EQ(drain(), TRACE_RECORDS);
+    CHECK_EQ(records[TRACE_RECORDS - 1].args[0], TRACE_RECORDS - 1);
+}
@@ -3,8 +3,60 @@
 #include "usermode.h"
 #include "process.h"
 #include "fs.h"
+#include "vdso.h"
+#include "timer.h"
+#include "uart.h"
+#include "boot.h"
+#include "riscv.h"
+#include "sbi.h"
+#include "workqueue.h"
+#include "shm.h"
+#include "tick.h"
 
-void kmain(void) {
+#define LOG_SUBSYS LOG_CORE
+
+struct boot_phase {
+    const char *name;
+    uint64_t time;
+};
+
+static struct boot_phase boot_phases[BOOT_MAX_PHASES];
+static int boot_nphases;
+
+void boot_mark(const char *phase) {
+    if (boot_nphases < BOOT_MAX_PHASES) {
+        boot_phases[boot_nphases].name = phase;
+        boot_phases[boot_nphases].time = read_time();
+        boot_nphases++;
+    }
+}
+
+// One line: microseconds spent in each phase, then entry to the last mark
+void boot_report(void) {
+    if (boot_nphases < 2) return;
+    
+    printk("boot:");
+    for (int i = 1; i < boot_nphases; i++) {
+        printk(" %s=%luus", boot_phases[i].name,
+               (boot_phases[i].time - boot_phases[i - 1].time) * 1000000 / TIMEBASE_FREQ);
+    }
+    printk(" total=%luus\n",
+           (boot_phases[boot_nphases - 1].time - boot_phases[0].time) * 1000000 / TIMEBASE_FREQ);
+}
+
+void kernel_poweroff(int code) {
+    printk("Powering off (exit code %d)\n", code);
+    // Synchronous from here on, draining the UART queue first
+    printk_emergency();
+    sbi_shutdown(code ? SBI_SRST_REASON_FAILURE : SBI_SRST_REASON_NONE);
+    
+    printk("SBI SRST unavailable, halting\n");
+    while (1) {
+        asm volatile("wfi");
+    }
+}
+
+static void print_banner(void) {
     printk("                ,----..               \n");
     printk("               /   /   \\   .--.--.    \n");
     printk("       ,---.  /   .     : /  /    '.  \n");
@@ -18,18 +70,43 @@ void kmain(void) {
     printk("    \\   `  ;  ;   :    / '--'.     /  \n");
     printk("     :   \\ |   \\   \\ .'    `--'---'   \n");
     printk("      '---\"     `---`                 \n");
+}
 
+// boot.S hands over the time CSR at _start and after clearing .bss
+void kmain(uint64_t entry_time, uint64_t bss_time) {
+    boot_phases[0] = (struct boot_phase){ "entry", entry_time };
+    boot_phases[1] = (struct boot_phase){ "bss", bss_time };
+    boot_nphases = 2;
+    
+#ifndef CONFIG_QUIET_BOOT
+    print_banner();
+    boot_mark("banner");
+#endif
+    
     uint64_t sstatus;
     asm volatile("csrr %0, sstatus" : "=r"(sstatus));
-    printk("sstatus: 0x%lx\n", sstatus);
+    pr_debug("sstatus: 0x%lx\n", sstatus);
     
     uint64_t satp;
     asm volatile("csrr %0, satp" : "=r"(satp));
-    printk("satp (before): 0x%lx\n", satp);
+    pr_debug("satp (before): 0x%lx\n", satp);
     
     process_init();
+    boot_mark("proc");
     fs_init();
+    shm_init();
+    boot_mark("fs");
     trap_init();
+    boot_mark("trap");
+    uart_init();
+    boot_mark("uart");
+    vdso_init();
+    boot_mark("vdso");
+    timer_init();
+    tick_start();
+    workqueue_init();
+    printk_start_flusher();
+    boot_mark("timer");
     printk("Kernel initialization complete!\n");
     printk("Launching POSIX Compliance Test\n");
     printk("\n");
@@ -37,6 +114,7 @@ void kmain(void) {
     printk("Entering idle loop...\n");
     
     while (1) {
-        asm volatile("wfi");
+        printk_flush();
+        tick_idle();
     }
 }
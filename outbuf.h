@@ -0,0 +1,66 @@
+#ifndef OUTBUF_H
+#define OUTBUF_H
+
+#include <stdint.h>
+
+/*
+ * stdio-style buffering in front of write() for user programs: one trap
+ * per line or per buffer instead of one per byte. It makes its own
+ * write ecall so that programs with their own syscall wrappers, like
+ * usermode.c, can use it without unistd.h.
+ */
+#define OUTBUF_SIZE 256
+
+#define OUTBUF_FULL 0
+#define OUTBUF_LINE 1
+#define OUTBUF_NONE 2
+
+struct outbuf {
+    int fd;
+    int mode;
+    int len;
+    char buf[OUTBUF_SIZE];
+};
+
+static struct outbuf stdout_buf __attribute__((unused)) = { 1, OUTBUF_LINE, 0, { 0 } };
+static struct outbuf stderr_buf __attribute__((unused)) = { 2, OUTBUF_NONE, 0, { 0 } };
+
+static inline int outbuf_write(int fd, const char *buf, int len) {
+    register uint64_t a0 asm("a0") = fd;
+    register uint64_t a1 asm("a1") = (uint64_t)buf;
+    register uint64_t a2 asm("a2") = len;
+    register uint64_t a7 asm("a7") = 4;
+    asm volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a7) : "memory");
+    return (int)a0;
+}
+
+static inline int outbuf_flush(struct outbuf *ob) {
+    int off = 0;
+    while (off < ob->len) {
+        int n = outbuf_write(ob->fd, ob->buf + off, ob->len - off);
+        if (n <= 0) break;
+        off += n;
+    }
+    int ret = off == ob->len ? 0 : -1;
+    ob->len = 0;
+    return ret;
+}
+
+static inline void outbuf_putc(struct outbuf *ob, char c) {
+    ob->buf[ob->len++] = c;
+    if (ob->len == OUTBUF_SIZE || ob->mode == OUTBUF_NONE ||
+        (ob->mode == OUTBUF_LINE && c == '\n')) {
+        outbuf_flush(ob);
+    }
+}
+
+static inline void outbuf_puts(struct outbuf *ob, const char *s) {
+    int mode = ob->mode;
+    // Unbuffered streams still get one write per string
+    if (mode == OUTBUF_NONE) ob->mode = OUTBUF_FULL;
+    while (*s) outbuf_putc(ob, *s++);
+    ob->mode = mode;
+    if (mode == OUTBUF_NONE) outbuf_flush(ob);
+}
+
+#endif
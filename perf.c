@@ -0,0 +1,300 @@
+#include "perf.h"
+#include "sbi.h"
+#include "fs.h"
+#include "process.h"
+#include "printk.h"
+
+#define LOG_SUBSYS LOG_DEV
+
+#define PMU_MAX_COUNTERS 64
+
+// counter_config_matching flags
+#define PMU_CFG_CLEAR_VALUE 0x02
+#define PMU_CFG_AUTO_START  0x04
+#define PMU_CFG_VUINH       0x08
+#define PMU_CFG_VSINH       0x10
+#define PMU_CFG_UINH        0x20
+#define PMU_CFG_SINH        0x40
+#define PMU_CFG_MINH        0x80
+
+#define PMU_STOP_RESET 0x1
+
+#define PMU_EVENT_TYPE_HW    0
+#define PMU_EVENT_TYPE_CACHE 1
+
+struct pmu_counter {
+    uint16_t csr;
+    uint8_t width;
+    uint8_t firmware;
+};
+
+/*
+ * An open event owns one PMU counter, which runs continuously once
+ * configured. Per-process virtualization is by snapshot: while the
+ * owner is on the hart, base holds the raw value it was switched in
+ * at, and switching out folds the difference into count. That costs a
+ * CSR read per switch instead of an SBI stop/start round trip.
+ */
+struct perf_event {
+    int in_use;
+    int owner;
+    int counter;
+    int enabled;
+    int active;
+    uint64_t event_idx;
+    uint64_t count;
+    uint64_t base;
+};
+
+static struct perf_event events[PERF_MAX_EVENTS];
+static struct pmu_counter counters[PMU_MAX_COUNTERS];
+static int num_counters;
+static int pmu_state = -1;
+
+static uint64_t switches_accounted;
+
+#define CSR_READ_CASE(n)                                            \
+    case 0xc00 + (n):                                               \
+        asm volatile("csrr %0, %1" : "=r"(v) : "i"(0xc00 + (n)));   \
+        break
+
+// csrr needs the CSR number as an immediate
+static uint64_t read_counter_csr(int csr) {
+    uint64_t v = 0;
+    switch (csr) {
+        CSR_READ_CASE(0);  CSR_READ_CASE(1);  CSR_READ_CASE(2);  CSR_READ_CASE(3);
+        CSR_READ_CASE(4);  CSR_READ_CASE(5);  CSR_READ_CASE(6);  CSR_READ_CASE(7);
+        CSR_READ_CASE(8);  CSR_READ_CASE(9);  CSR_READ_CASE(10); CSR_READ_CASE(11);
+        CSR_READ_CASE(12); CSR_READ_CASE(13); CSR_READ_CASE(14); CSR_READ_CASE(15);
+        CSR_READ_CASE(16); CSR_READ_CASE(17); CSR_READ_CASE(18); CSR_READ_CASE(19);
+        CSR_READ_CASE(20); CSR_READ_CASE(21); CSR_READ_CASE(22); CSR_READ_CASE(23);
+        CSR_READ_CASE(24); CSR_READ_CASE(25); CSR_READ_CASE(26); CSR_READ_CASE(27);
+        CSR_READ_CASE(28); CSR_READ_CASE(29); CSR_READ_CASE(30); CSR_READ_CASE(31);
+    }
+    return v;
+}
+
+// Probed on first use; the counter layout can't change after boot
+static int pmu_probe(void) {
+    if (pmu_state >= 0) return pmu_state;
+    
+    pmu_state = 0;
+    if (!sbi_probe_extension(SBI_EXT_PMU)) {
+        pr_info("perf: firmware has no SBI PMU extension\n");
+        return 0;
+    }
+    
+    struct sbiret ret = sbi_ecall(SBI_EXT_PMU, SBI_PMU_NUM_COUNTERS, 0, 0, 0);
+    num_counters = ret.error ? 0 : ret.value;
+    if (num_counters > PMU_MAX_COUNTERS) {
+        num_counters = PMU_MAX_COUNTERS;
+    }
+    
+    int hw = 0;
+    for (int i = 0; i < num_counters; i++) {
+        ret = sbi_ecall(SBI_EXT_PMU, SBI_PMU_COUNTER_INFO, i, 0, 0);
+        if (ret.error) continue;
+        uint64_t info = ret.value;
+        counters[i].firmware = info >> 63;
+        counters[i].csr = info & 0xfff;
+        counters[i].width = ((info >> 12) & 0x3f) + 1;
+        hw += !counters[i].firmware;
+    }
+    
+    pr_info("perf: SBI PMU with %d counters (%d hardware)\n", num_counters, hw);
+    pmu_state = num_counters > 0;
+    return pmu_state;
+}
+
+static uint64_t counter_read(int idx) {
+    const struct pmu_counter *c = &counters[idx];
+    if (c->firmware) {
+        return sbi_ecall(SBI_EXT_PMU, SBI_PMU_COUNTER_FW_READ, idx, 0, 0).value;
+    }
+    return read_counter_csr(c->csr);
+}
+
+static uint64_t counter_delta(int idx, uint64_t from, uint64_t to) {
+    int width = counters[idx].width;
+    uint64_t mask = width >= 64 ? ~0ULL : (1ULL << width) - 1;
+    return (to - from) & mask;
+}
+
+static void event_fold(struct perf_event *e) {
+    uint64_t now = counter_read(e->counter);
+    e->count += counter_delta(e->counter, e->base, now);
+    e->base = now;
+}
+
+// Linux-style type/config to an SBI event_idx, or 0 if there is none
+static uint64_t attr_to_event_idx(const struct perf_event_attr *attr) {
+    switch (attr->type) {
+        case PERF_TYPE_HARDWARE:
+            if (attr->config > PERF_COUNT_HW_BRANCH_MISSES) return 0;
+            return PMU_EVENT_TYPE_HW << 16 | (attr->config + 1);
+        case PERF_TYPE_HW_CACHE: {
+            uint64_t id = attr->config & 0xff;
+            uint64_t op = (attr->config >> 8) & 0xff;
+            uint64_t result = (attr->config >> 16) & 0xff;
+            if (id > 6 || op > 2 || result > 1) return 0;
+            return PMU_EVENT_TYPE_CACHE << 16 | id << 3 | op << 1 | result;
+        }
+        case PERF_TYPE_RAW:
+            return attr->config;
+        default:
+            return 0;
+    }
+}
+
+/*
+ * Counts for the calling process only (pid 0 or its own pid), in the
+ * style of perf_event_open(2). Returns a descriptor whose read()
+ * yields the 64-bit count.
+ */
+int perf_event_create(const struct perf_event_attr *attr, int pid) {
+    process_t *proc = process_current();
+    if (!attr || !proc || (pid != 0 && pid != proc->pid)) return -1;
+    if (!pmu_probe()) return -1;
+    
+    uint64_t event_idx = attr_to_event_idx(attr);
+    if (!event_idx) return -1;
+    
+    int idx;
+    for (idx = 0; idx < PERF_MAX_EVENTS && events[idx].in_use; idx++) {
+    }
+    if (idx == PERF_MAX_EVENTS) return -1;
+    
+    uint64_t flags = PMU_CFG_CLEAR_VALUE | PMU_CFG_AUTO_START;
+    if (attr->flags & PERF_ATTR_EXCLUDE_KERNEL) flags |= PMU_CFG_SINH | PMU_CFG_MINH;
+    if (attr->flags & PERF_ATTR_EXCLUDE_USER) flags |= PMU_CFG_UINH;
+    uint64_t mask = num_counters >= 64 ? ~0ULL : (1ULL << num_counters) - 1;
+    
+    struct sbiret ret = sbi_ecall5(SBI_EXT_PMU, SBI_PMU_CONFIG_MATCH, 0, mask,
+                                   flags, event_idx, 0);
+    if (ret.error || ret.value < 0 || ret.value >= num_counters) {
+        pr_debug("perf: no counter for event 0x%lx (error %ld)\n", event_idx, ret.error);
+        return -1;
+    }
+    
+    int fd = fs_alloc_fd(FD_PERF, idx, O_RDONLY);
+    if (fd < 0) {
+        sbi_ecall(SBI_EXT_PMU, SBI_PMU_COUNTER_STOP, ret.value, 1, PMU_STOP_RESET);
+        return -1;
+    }
+    
+    struct perf_event *e = &events[idx];
+    e->in_use = 1;
+    e->owner = proc->pid;
+    e->counter = ret.value;
+    e->event_idx = event_idx;
+    e->count = 0;
+    e->enabled = !(attr->flags & PERF_ATTR_DISABLED);
+    e->active = e->enabled;
+    e->base = counter_read(e->counter);
+    return fd;
+}
+
+static struct perf_event *event_from_fd(int fd) {
+    if (fd < 0 || fd >= MAX_FDS || !fd_table[fd].in_use || fd_table[fd].type != FD_PERF) {
+        return 0;
+    }
+    return &events[fd_table[fd].file_idx];
+}
+
+// The owner is the process issuing the syscall whenever it is running
+static int owner_running(const struct perf_event *e) {
+    process_t *proc = process_current();
+    return proc && proc->pid == e->owner;
+}
+
+int perf_event_ctl(int fd, int cmd) {
+    struct perf_event *e = event_from_fd(fd);
+    if (!e) return -1;
+    
+    switch (cmd) {
+        case PERF_IOC_ENABLE:
+            if (!e->enabled && owner_running(e)) {
+                e->base = counter_read(e->counter);
+                e->active = 1;
+            }
+            e->enabled = 1;
+            return 0;
+        case PERF_IOC_DISABLE:
+            if (e->active) {
+                event_fold(e);
+                e->active = 0;
+            }
+            e->enabled = 0;
+            return 0;
+        case PERF_IOC_RESET:
+            if (e->active) {
+                e->base = counter_read(e->counter);
+            }
+            e->count = 0;
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+int perf_read(int idx, void *buf, uint32_t count) {
+    struct perf_event *e = &events[idx];
+    if (count < sizeof(uint64_t)) return -1;
+    
+    if (e->active) {
+        event_fold(e);
+    }
+    *(uint64_t *)buf = e->count;
+    return sizeof(uint64_t);
+}
+
+// From fs_close: hands the counter back to the firmware
+void perf_release(int idx) {
+    struct perf_event *e = &events[idx];
+    if (!e->in_use) return;
+    
+    sbi_ecall(SBI_EXT_PMU, SBI_PMU_COUNTER_STOP, e->counter, 1, PMU_STOP_RESET);
+    e->in_use = 0;
+    e->active = 0;
+}
+
+// Events count for one task, so their fds go with it rather than leak
+void perf_release_process(int pid) {
+    for (int fd = 0; fd < MAX_FDS; fd++) {
+        struct perf_event *e = event_from_fd(fd);
+        if (e && e->owner == pid) {
+            fs_close(fd);
+        }
+    }
+}
+
+// Called on every context switch, with prev NULL if nothing was running
+void perf_switch(process_t *prev, process_t *next) {
+    int prev_pid = prev ? prev->pid : -1;
+    
+    for (int i = 0; i < PERF_MAX_EVENTS; i++) {
+        struct perf_event *e = &events[i];
+        if (!e->in_use || !e->enabled) continue;
+        
+        if (e->owner == prev_pid && e->active) {
+            event_fold(e);
+            e->active = 0;
+            switches_accounted++;
+        }
+        if (e->owner == next->pid) {
+            e->base = counter_read(e->counter);
+            e->active = 1;
+        }
+    }
+}
+
+void perf_dump_stats(void) {
+    int open = 0;
+    for (int i = 0; i < PERF_MAX_EVENTS; i++) {
+        open += events[i].in_use;
+    }
+    if (pmu_state < 0 && !open) return;
+    
+    printk("perf: %d counters, %d events open, %lu switch-outs accounted\n",
+           num_counters, open, switches_accounted);
+}
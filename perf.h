@@ -0,0 +1,19 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdint.h>
+#include "perf_uapi.h"
+
+struct process;
+
+#define PERF_MAX_EVENTS 16
+
+int perf_event_create(const struct perf_event_attr *attr, int pid);
+int perf_event_ctl(int fd, int cmd);
+int perf_read(int idx, void *buf, uint32_t count);
+void perf_release(int idx);
+void perf_release_process(int pid);
+void perf_switch(struct process *prev, struct process *next);
+void perf_dump_stats(void);
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef PERF_UAPI_H
+#define PERF_UAPI_H
+
+#include <stdint.h>
+
+// The perf syscalls' ABI, shared by the kernel and user programs
+
+// perf_event_attr.type, numbered as on Linux
+#define PERF_TYPE_HARDWARE 0
+#define PERF_TYPE_HW_CACHE 3
+#define PERF_TYPE_RAW      4
+
+// PERF_TYPE_HARDWARE configs
+#define PERF_COUNT_HW_CPU_CYCLES          0
+#define PERF_COUNT_HW_INSTRUCTIONS        1
+#define PERF_COUNT_HW_CACHE_REFERENCES    2
+#define PERF_COUNT_HW_CACHE_MISSES        3
+#define PERF_COUNT_HW_BRANCH_INSTRUCTIONS 4
+#define PERF_COUNT_HW_BRANCH_MISSES       5
+
+// PERF_TYPE_HW_CACHE config is id | op << 8 | result << 16
+#define PERF_COUNT_HW_CACHE_L1D  0
+#define PERF_COUNT_HW_CACHE_L1I  1
+#define PERF_COUNT_HW_CACHE_LL   2
+#define PERF_COUNT_HW_CACHE_DTLB 3
+#define PERF_COUNT_HW_CACHE_ITLB 4
+
+#define PERF_COUNT_HW_CACHE_OP_READ  0
+#define PERF_COUNT_HW_CACHE_OP_WRITE 1
+
+#define PERF_COUNT_HW_CACHE_RESULT_ACCESS 0
+#define PERF_COUNT_HW_CACHE_RESULT_MISS   1
+
+#define PERF_CACHE_CONFIG(id, op, result) ((id) | (op) << 8 | (result) << 16)
+
+// perf_event_attr.flags
+#define PERF_ATTR_DISABLED       0x1
+#define PERF_ATTR_EXCLUDE_KERNEL 0x2
+#define PERF_ATTR_EXCLUDE_USER   0x4
+
+// perf_ctl() commands, in place of the Linux ioctls
+#define PERF_IOC_ENABLE  0
+#define PERF_IOC_DISABLE 1
+#define PERF_IOC_RESET   2
+
+/*
+ * PERF_TYPE_RAW configs are SBI PMU event_idx values, passed through
+ * unchanged (e.g. 0x10019 for DTLB read misses on QEMU).
+ */
+struct perf_event_attr {
+    uint32_t type;
+    uint32_t flags;
+    uint64_t config;
+};
+
+#endif
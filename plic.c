@@ -0,0 +1,91 @@
+#include "plic.h"
+#include "trap.h"
+#include "hart.h"
+#include "printk.h"
+#include "riscv.h"
+#include <stddef.h>
+
+// QEMU virt PLIC; S-mode context of hart N is context 2N+1
+#define PLIC_BASE            0x0c000000UL
+#define PLIC_PRIORITY(irq)   (PLIC_BASE + 4 * (irq))
+#define PLIC_SENABLE(hart)   (PLIC_BASE + 0x2080 + (hart) * 0x100)
+#define PLIC_STHRESHOLD(hart) (PLIC_BASE + 0x201000 + (hart) * 0x2000)
+#define PLIC_SCLAIM(hart)    (PLIC_BASE + 0x201004 + (hart) * 0x2000)
+
+#define SIE_SEIE (1UL << 9)
+
+static struct {
+    irq_handler_t handler;
+    void *arg;
+} irq_handlers[PLIC_MAX_IRQ];
+
+static struct irq_stats plic_stats[PLIC_MAX_IRQ];
+static uint64_t spurious_irqs;
+
+static inline void mmio_write32(uint64_t addr, uint32_t val) {
+    *(volatile uint32_t *)addr = val;
+}
+
+static inline uint32_t mmio_read32(uint64_t addr) {
+    return *(volatile uint32_t *)addr;
+}
+
+void plic_init(void) {
+    for (int irq = 1; irq < PLIC_MAX_IRQ; irq++) {
+        mmio_write32(PLIC_PRIORITY(irq), 0);
+    }
+}
+
+void plic_init_hart(void) {
+    uint64_t hart = hart_id();
+    
+    for (int irq = 0; irq < PLIC_MAX_IRQ; irq += 32) {
+        mmio_write32(PLIC_SENABLE(hart) + irq / 8, 0);
+    }
+    mmio_write32(PLIC_STHRESHOLD(hart), 0);
+    
+    asm volatile("csrs sie, %0" :: "r"(SIE_SEIE));
+}
+
+int plic_register(int irq, irq_handler_t handler, void *arg) {
+    if (irq <= 0 || irq >= PLIC_MAX_IRQ || !handler) {
+        return -1;
+    }
+    
+    irq_handlers[irq].handler = handler;
+    irq_handlers[irq].arg = arg;
+    
+    uint64_t enable = PLIC_SENABLE(hart_id()) + (irq / 32) * 4;
+    mmio_write32(PLIC_PRIORITY(irq), 1);
+    mmio_write32(enable, mmio_read32(enable) | (1U << (irq % 32)));
+    return 0;
+}
+
+// Claims and services every pending source before returning
+void plic_dispatch(void) {
+    uint64_t claim = PLIC_SCLAIM(hart_id());
+    uint32_t irq;
+    
+    while ((irq = mmio_read32(claim)) != 0) {
+        uint64_t start = read_cycle();
+        
+        if (irq < PLIC_MAX_IRQ && irq_handlers[irq].handler) {
+            irq_handlers[irq].handler(irq, irq_handlers[irq].arg);
+            irq_stats_record(&plic_stats[irq], read_cycle() - start, 0);
+        } else {
+            spurious_irqs++;
+        }
+        
+        mmio_write32(claim, irq);
+    }
+}
+
+void plic_dump_stats(void) {
+    for (int irq = 1; irq < PLIC_MAX_IRQ; irq++) {
+        const struct irq_stats *st = &plic_stats[irq];
+        if (st->count == 0) continue;
+        printk("  irq %d: %lu, avg %lu cycles, max %lu cycles\n",
+               irq, st->count, st->cycles / st->count, st->max_cycles);
+    }
+    printk("  spurious: %lu\n", spurious_irqs);
+}
@@ -0,0 +1,18 @@
+#ifndef PLIC_H
+#define PLIC_H
+
+#include <stdint.h>
+
+#define PLIC_MAX_IRQ 64
+
+#define UART0_IRQ 10
+
+typedef void (*irq_handler_t)(int irq, void *arg);
+
+void plic_init(void);
+void plic_init_hart(void);
+int plic_register(int irq, irq_handler_t handler, void *arg);
+void plic_dispatch(void);
+void plic_dump_stats(void);
+
+#endif
@@ -1,14 +1,153 @@
 #include "printk.h"
+#include "sbi.h"
+#include "uart.h"
+#include "trap.h"
+#include "hart.h"
+#include "boot.h"
+#include "timer.h"
+#include "riscv.h"
+#include "workqueue.h"
 #include <stdarg.h>
 
-static void sbi_console_putchar(int ch) {
-    register unsigned long a0 asm("a0") = ch;
-    register unsigned long a7 asm("a7") = 1;
-    asm volatile("ecall" : "+r"(a0) : "r"(a7) : "memory");
+#define PRINTK_RING_MASK (PRINTK_RING_SIZE - 1)
+
+/*
+ * One ring per hart, so printk never contends with another hart: the
+ * owning hart is the only producer and publishes head with a release
+ * store, and whoever holds the flush flag consumes up to it. Kernel code
+ * runs with interrupts off, so a hart never re-enters its own producer.
+ */
+struct printk_ring {
+    uint64_t head;
+    uint64_t tail;
+    uint64_t pos;
+    uint64_t overruns;
+};
+
+static struct printk_ring printk_rings[MAX_HARTS];
+static char printk_bufs[MAX_HARTS][PRINTK_RING_SIZE] __noinit;
+
+uint8_t log_levels[LOG_NR_SUBSYS] = { [0 ... LOG_NR_SUBSYS - 1] = CONFIG_LOG_LEVEL };
+
+static int flushing;
+static int emergency;
+static int flusher_started;
+static int dbcn_state = -1;
+static struct timer flush_timer;
+static struct work flush_work;
+
+static uint64_t flushes;
+static uint64_t flushed_bytes;
+static uint64_t console_calls;
+
+static void console_write(const char *s, uint64_t len) {
+    if (uart_ready()) {
+        if (emergency) {
+            uart_write_sync(s, len);
+        } else {
+            uart_write(s, len);
+        }
+        console_calls++;
+        return;
+    }
+    
+    if (dbcn_state < 0) {
+        dbcn_state = sbi_probe_extension(SBI_EXT_DBCN);
+    }
+    
+    while (len > 0) {
+        long n = dbcn_state ? sbi_debug_console_write(s, len) : -1;
+        console_calls++;
+        if (n <= 0) {
+            sbi_console_putchar(*s);
+            n = 1;
+        }
+        s += n;
+        len -= n;
+    }
+}
+
+static void ring_drain(struct printk_ring *r) {
+    uint64_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    uint64_t tail = r->tail;
+    
+    while (tail != head) {
+        uint64_t off = tail & PRINTK_RING_MASK;
+        uint64_t len = head - tail;
+        if (len > PRINTK_RING_SIZE - off) {
+            len = PRINTK_RING_SIZE - off;
+        }
+        console_write(&printk_bufs[r - printk_rings][off], len);
+        tail += len;
+        flushed_bytes += len;
+        __atomic_store_n(&r->tail, tail, __ATOMIC_RELEASE);
+    }
+}
+
+void printk_flush(void) {
+    if (__atomic_exchange_n(&flushing, 1, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    
+    for (int i = 0; i < MAX_HARTS; i++) {
+        ring_drain(&printk_rings[i]);
+    }
+    flushes++;
+    
+    __atomic_store_n(&flushing, 0, __ATOMIC_RELEASE);
+}
+
+static void printk_flush_work(struct work *w) {
+    (void)w;
+    printk_flush();
+}
+
+// Console output is slow, so it is left to kworker, off the interrupt path
+static void printk_flush_timer(struct timer *t) {
+    (void)t;
+    if (workqueue_ready()) {
+        work_queue(&flush_work);
+    } else {
+        printk_flush();
+    }
+}
+
+void printk_start_flusher(void) {
+    work_init(&flush_work, printk_flush_work);
+    flusher_started = 1;
+    printk_flush();
+}
+
+/*
+ * For panics and fatal faults: push out everything buffered and write
+ * every later message straight to the console, so nothing is lost if
+ * the kernel never gets back to a flush point.
+ */
+void printk_emergency(void) {
+    __atomic_store_n(&emergency, 1, __ATOMIC_RELEASE);
+    // The hart holding the flag may be the one that faulted
+    __atomic_store_n(&flushing, 0, __ATOMIC_RELEASE);
+    printk_flush();
 }
 
 static void putchar(char c) {
-    sbi_console_putchar(c);
+    if (emergency) {
+        console_write(&c, 1);
+        return;
+    }
+    
+    struct printk_ring *r = &printk_rings[hart_id()];
+    if (r->pos - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) >= PRINTK_RING_SIZE) {
+        // Full: publish what we have and pay for one synchronous flush
+        __atomic_store_n(&r->head, r->pos, __ATOMIC_RELEASE);
+        r->overruns++;
+        printk_flush();
+        while (r->pos - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) >= PRINTK_RING_SIZE) {
+            printk_flush();
+        }
+    }
+    printk_bufs[r - printk_rings][r->pos & PRINTK_RING_MASK] = c;
+    r->pos++;
 }
 
 static void puts(const char *s) {
@@ -93,4 +232,46 @@ void printk(const char *fmt, ...) {
     }
     
     va_end(args);
+    
+    if (emergency) return;
+    
+    struct printk_ring *r = &printk_rings[hart_id()];
+    __atomic_store_n(&r->head, r->pos, __ATOMIC_RELEASE);
+    
+    // A flush a few ms late hurts no one, so it rides along with other wakeups
+    if (flusher_started && !timer_pending(&flush_timer)) {
+        timer_add_slack(&flush_timer, read_time() + timer_ns_to_ticks(PRINTK_FLUSH_NS),
+                        timer_ns_to_ticks(PRINTK_FLUSH_NS / 2), printk_flush_timer, 0);
+    }
+}
+
+void printk_dump_stats(void) {
+    uint64_t overruns = 0;
+    for (int i = 0; i < MAX_HARTS; i++) {
+        overruns += printk_rings[i].overruns;
+    }
+    printk("printk: %lu flushes, %lu bytes in %lu console calls (%s), %lu ring overruns\n",
+           flushes, flushed_bytes, console_calls,
+           uart_ready() ? "UART" : dbcn_state > 0 ? "DBCN" : "legacy putchar", overruns);
+}
+
+/*
+ * Sets subsys's threshold, or every subsystem's when subsys is -1, and
+ * returns the previous one; a negative level only queries. Levels above
+ * CONFIG_LOG_LEVEL are accepted but can't bring back compiled-out calls.
+ */
+int log_set_level(int subsys, int level) {
+    if (subsys < -1 || subsys >= LOG_NR_SUBSYS || level > LOG_DEBUG) {
+        return -1;
+    }
+    
+    int old = log_levels[subsys < 0 ? LOG_CORE : subsys];
+    if (level < 0) return old;
+    
+    for (int i = 0; i < LOG_NR_SUBSYS; i++) {
+        if (subsys < 0 || i == subsys) {
+            log_levels[i] = level;
+        }
+    }
+    return old;
 }
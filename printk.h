@@ -3,6 +3,56 @@
 
 #include <stdint.h>
 
+// Per-hart log buffer; must be a power of two
+#define PRINTK_RING_SIZE 16384
+
+// Flush period for buffered output once the timer wheel is up
+#define PRINTK_FLUSH_NS 10000000ULL
+
+#define LOG_ERR   0
+#define LOG_WARN  1
+#define LOG_INFO  2
+#define LOG_DEBUG 3
+
+// Calls above this level compile away; set with -DLOG_LEVEL=n in CMake
+#ifndef CONFIG_LOG_LEVEL
+#define CONFIG_LOG_LEVEL LOG_INFO
+#endif
+
+#define LOG_CORE    0
+#define LOG_PROC    1
+#define LOG_SYSCALL 2
+#define LOG_TRAP    3
+#define LOG_FS      4
+#define LOG_MM      5
+#define LOG_TIMER   6
+#define LOG_DEV     7
+#define LOG_NR_SUBSYS 8
+
+// Runtime threshold per subsystem, indexed by LOG_CORE..LOG_DEV
+extern uint8_t log_levels[LOG_NR_SUBSYS];
+
+/*
+ * A file using these defines LOG_SUBSYS to one of the subsystems above.
+ * The build-time check is a constant, so a disabled call leaves neither
+ * the branch nor the format string behind.
+ */
+#define pr_log(level, fmt, ...)                                          \
+    do {                                                                 \
+        if ((level) <= CONFIG_LOG_LEVEL && (level) <= log_levels[LOG_SUBSYS]) \
+            printk(fmt, ##__VA_ARGS__);                                  \
+    } while (0)
+
+#define pr_err(fmt, ...)   pr_log(LOG_ERR, fmt, ##__VA_ARGS__)
+#define pr_warn(fmt, ...)  pr_log(LOG_WARN, fmt, ##__VA_ARGS__)
+#define pr_info(fmt, ...)  pr_log(LOG_INFO, fmt, ##__VA_ARGS__)
+#define pr_debug(fmt, ...) pr_log(LOG_DEBUG, fmt, ##__VA_ARGS__)
+
 void printk(const char *fmt, ...);
+void printk_flush(void);
+void printk_start_flusher(void);
+void printk_emergency(void);
+void printk_dump_stats(void);
+int log_set_level(int subsys, int level);
 
 #endif
@@ -1,33 +1,59 @@
 #include "process.h"
 #include "printk.h"
+#include "vdso.h"
+#include "trap.h"
+#include "riscv.h"
+#include "signal.h"
+#include "spinlock.h"
+#include "hart.h"
+#include "boot.h"
+#include "perf.h"
+#include "trace.h"
+#include "futex.h"
+#include "shm.h"
+#include "tick.h"
 #include <stddef.h>
 
+#define LOG_SUBSYS LOG_PROC
+
 process_t proc_table[MAX_PROCESSES];
-int current_pid = 0;
-static int next_pid = 1;
+// PID 1 is init, set up by hand in process_init
+static int next_pid = 2;
+
+// Guards slot allocation, next_pid and every proc->state transition
+static spinlock_t proc_lock;
+// Summed runtime / period of every admitted deadline task, see dl_admit
+static uint64_t dl_total_bw;
+
+_Static_assert(MAX_PROCESSES <= sizeof(((struct hart *)0)->runq.slots),
+               "run queue must hold every slot");
+
+static uint64_t process_block_wait(process_t *proc);
 
 void process_init(void) {
     printk("Initializing process table...\n");
-    for (int i = 0; i < MAX_PROCESSES; i++) {
-        proc_table[i].state = PROC_UNUSED;
-        proc_table[i].pid = 0;
-        proc_table[i].stack = NULL;
-    }
+    spin_init(&proc_lock, "proc_table");
+    dl_total_bw = 0;
     
+    // proc_table is in .bss: every slot already starts PROC_UNUSED
     proc_table[0].pid = 1;
+    proc_table[0].tgid = 1;
     proc_table[0].ppid = 0;
     proc_table[0].state = PROC_RUNNING;
     for (int i = 0; i < PROC_NAME_LEN && "init"[i]; i++) {
         proc_table[0].name[i] = "init"[i];
     }
-    current_pid = 1;
+    proc_table[0].timer_slack = timer_ns_to_ticks(CONFIG_TIMER_SLACK_NS);
+    this_hart()->current_pid = 1;
+    this_hart()->running_pid = 1;
     
     printk("Init process created (PID 1)\n");
 }
 
 process_t *process_current(void) {
+    int pid = this_hart()->current_pid;
     for (int i = 0; i < MAX_PROCESSES; i++) {
-        if (proc_table[i].pid == current_pid) {
+        if (proc_table[i].pid == pid) {
             return &proc_table[i];
         }
     }
@@ -43,21 +69,265 @@ process_t *process_get(int pid) {
     return NULL;
 }
 
-int process_create(const char *name, void (*entry)(void)) {
+/*
+ * READY processes wait on the run queue of the hart that readied them.
+ * A process that dies while queued leaves its entry behind, so pop skips
+ * anything no longer READY; on_runq stays set until that entry is
+ * consumed so a reused slot is never queued twice. Caller holds proc_lock.
+ */
+static void runq_push(process_t *proc) {
+    if (proc->on_runq || proc->policy == SCHED_DEADLINE) return;
+    
+    struct hart *h = this_hart();
+    h->runq.slots[h->runq.tail++ % MAX_PROCESSES] = proc - proc_table;
+    proc->on_runq = 1;
+}
+
+// Runs proc next on this hart, ahead of everything already queued
+static void runq_push_front(process_t *proc) {
+    if (proc->on_runq) return;
+    
+    struct hart *h = this_hart();
+    h->runq.slots[--h->runq.head % MAX_PROCESSES] = proc - proc_table;
+    proc->on_runq = 1;
+}
+
+static process_t *runq_pop(void) {
+    struct hart *h = this_hart();
+    while (h->runq.head != h->runq.tail) {
+        process_t *proc = &proc_table[h->runq.slots[h->runq.head++ % MAX_PROCESSES]];
+        proc->on_runq = 0;
+        if (proc->state == PROC_READY && proc->policy != SCHED_DEADLINE) return proc;
+    }
+    return NULL;
+}
+
+/*
+ * SCHED_DEADLINE. Each deadline task is a constant bandwidth server: it
+ * may run for runtime ticks in every period, and among those READY and
+ * within budget, the one with the earliest absolute deadline runs ahead
+ * of every normal process. Deadline tasks never sit on a run queue; the
+ * pick scans proc_table, which is only MAX_PROCESSES long. Admission
+ * keeps the summed runtime / period within DL_BW_MAX of one hart, which
+ * is what turns the deadlines into guarantees: EDF meets every deadline
+ * of a set that fits. All of this state is guarded by proc_lock.
+ */
+#define DL_BW_SHIFT 20
+// The rest of the hart is left to normal processes, as on Linux
+#define DL_BW_MAX         ((95ULL << DL_BW_SHIFT) / 100)
+#define DL_RUNTIME_MIN_NS 10000ULL
+#define DL_PERIOD_MAX_NS  (10 * NSEC_PER_SEC)
+
+static process_t *dl_pick(void) {
+    process_t *best = NULL;
+    for (int i = 0; i < MAX_PROCESSES; i++) {
+        process_t *p = &proc_table[i];
+        if (p->policy != SCHED_DEADLINE || p->state != PROC_READY || p->dl.throttled) continue;
+        if (!best || p->dl.abs_deadline < best->dl.abs_deadline) {
+            best = p;
+        }
+    }
+    return best;
+}
+
+// Every miss is traced and counted; the console only hears of the first
+static void dl_miss(process_t *proc, uint64_t now) {
+    uint64_t late = timer_ticks_to_ns(now - proc->dl.abs_deadline);
+    trace(TRACE_SCHED_DL_MISS, proc->pid, late);
+    if (proc->dl.misses++ == 0) {
+        pr_warn("sched: pid %d ('%s') missed its deadline by %lu us\n",
+                proc->pid, proc->name, late / 1000);
+    }
+}
+
+// Asks for a pick on the way out if proc, just made eligible, should run
+static void dl_check_preempt(process_t *proc) {
+    process_t *current = process_current();
+    if (current == proc) return;
+    if (!current || current->state != PROC_RUNNING || current->policy != SCHED_DEADLINE ||
+        current->dl.throttled || proc->dl.abs_deadline < current->dl.abs_deadline) {
+        this_hart()->need_resched = 1;
+    }
+}
+
+// The running job used up its budget; process_yield throttles it
+static void dl_enforce(struct timer *t) {
+    (void)t;
+    process_yield();
+}
+
+// proc was just picked, or kept running into a new period: arm the
+// budget. Caller holds proc_lock.
+static void dl_start(process_t *proc, uint64_t now) {
+    struct sched_dl *dl = &proc->dl;
+    // Throttled and only running because nothing else can
+    if (dl->throttled) return;
+    
+    dl->on_cpu = 1;
+    dl->exec_start = now;
+    timer_add(&dl->timer, now + dl->budget, dl_enforce, proc);
+}
+
+/*
+ * The next period has begun for a throttled task. Unless it yielded,
+ * it was throttled for running out of budget, so the job it was on has
+ * gone past its deadline unfinished.
+ */
+static void dl_replenish(struct timer *t) {
+    process_t *proc = (process_t *)t->arg;
+    struct sched_dl *dl = &proc->dl;
+    uint64_t flags = spin_lock_irqsave(&proc_lock);
+    uint64_t now = read_time();
+    if (!dl->yielded) {
+        dl_miss(proc, now);
+    }
+    dl->throttled = 0;
+    dl->yielded = 0;
+    dl->abs_deadline += dl->period;
+    if (dl->abs_deadline <= now) {
+        dl->abs_deadline = now + dl->deadline;
+    }
+    dl->budget = dl->runtime;
+    if (proc->state == PROC_READY) {
+        dl_check_preempt(proc);
+    } else if (proc->state == PROC_RUNNING) {
+        // Kept the hart while throttled, so no switch will start the job
+        dl_start(proc, now);
+    }
+    spin_unlock_irqrestore(&proc_lock, flags);
+    
+    if (this_hart()->need_resched) {
+        process_yield();
+    }
+}
+
+/*
+ * Bills the stint proc just ran to its budget. A job that ran dry, or
+ * ended early by sched_yield, is throttled until the start of its next
+ * period. Caller holds proc_lock.
+ */
+static void dl_charge(process_t *proc, uint64_t now) {
+    struct sched_dl *dl = &proc->dl;
+    if (!dl->on_cpu) return;
+    
+    dl->on_cpu = 0;
+    timer_cancel(&dl->timer);
+    uint64_t used = now - dl->exec_start;
+    dl->budget = used < dl->budget ? dl->budget - used : 0;
+    
+    // Blocking or yielding ends the job, late if past its deadline
+    if ((proc->state == PROC_BLOCKED || dl->yielded) && now > dl->abs_deadline) {
+        dl_miss(proc, now);
+    }
+    if (dl->yielded || (proc->state == PROC_RUNNING && dl->budget == 0)) {
+        if (!dl->yielded) {
+            dl->overruns++;
+        }
+        dl->throttled = 1;
+        timer_add(&dl->timer, dl->abs_deadline - dl->deadline + dl->period, dl_replenish, proc);
+    }
+}
+
+/*
+ * The CBS wakeup rule: a task that slept keeps its deadline and what is
+ * left of its budget only if running that budget before the deadline
+ * stays within its bandwidth; otherwise it starts a fresh job now. Caller
+ * holds proc_lock and has just made proc READY.
+ */
+static void dl_wakeup(process_t *proc) {
+    struct sched_dl *dl = &proc->dl;
+    if (proc->policy != SCHED_DEADLINE || dl->throttled) return;
+    
+    uint64_t now = read_time();
+    if (dl->abs_deadline <= now ||
+        dl->budget * dl->deadline > (dl->abs_deadline - now) * dl->runtime) {
+        dl->abs_deadline = now + dl->deadline;
+        dl->budget = dl->runtime;
+    }
+    dl_check_preempt(proc);
+}
+
+// Admission control, then a fresh job. Caller holds proc_lock.
+static int dl_admit(process_t *proc, uint64_t runtime, uint64_t deadline, uint64_t period) {
+    uint64_t bw = (runtime << DL_BW_SHIFT) / period;
+    uint64_t old = proc->policy == SCHED_DEADLINE ? proc->dl.bw : 0;
+    if (dl_total_bw - old + bw > DL_BW_MAX) {
+        pr_debug("sched: pid %d refused, bandwidth %lu + %lu over %lu\n",
+                 proc->pid, dl_total_bw - old, bw, DL_BW_MAX);
+        return -1;
+    }
+    dl_total_bw = dl_total_bw - old + bw;
+    
+    struct sched_dl *dl = &proc->dl;
+    if (proc->policy != SCHED_DEADLINE) {
+        dl->misses = 0;
+        dl->overruns = 0;
+    }
+    proc->policy = SCHED_DEADLINE;
+    timer_cancel(&dl->timer);
+    dl->runtime = runtime;
+    dl->deadline = deadline;
+    dl->period = period;
+    dl->bw = bw;
+    dl->abs_deadline = read_time() + deadline;
+    dl->budget = runtime;
+    dl->on_cpu = 0;
+    dl->throttled = 0;
+    dl->yielded = 0;
+    
+    // Picking again arms the budget, whether or not proc is the caller
+    this_hart()->need_resched = 1;
+    return 0;
+}
+
+// Back to round robin, handing the bandwidth back. Caller holds proc_lock.
+static void dl_leave(process_t *proc) {
+    if (proc->policy != SCHED_DEADLINE) return;
+    
+    dl_total_bw -= proc->dl.bw;
+    proc->policy = SCHED_NORMAL;
+    proc->dl.on_cpu = 0;
+    proc->dl.throttled = 0;
+    timer_cancel(&proc->dl.timer);
+    if (proc->state == PROC_READY) {
+        runq_push(proc);
+    }
+}
+
+// A thread nobody waits for is free once no hart is still running it
+static int slot_free(const process_t *proc) {
+    if (proc->state == PROC_UNUSED) return 1;
+    if (proc->state != PROC_ZOMBIE) return 0;
+    if (proc->pid == proc->tgid && !(proc->flags & PROC_F_KTHREAD)) return 0;
+    for (int i = 0; i < MAX_HARTS; i++) {
+        if (harts[i].running_pid == proc->pid) return 0;
+    }
+    return 1;
+}
+
+/*
+ * Claims a slot and resets it to a fresh single-threaded process whose
+ * parent is the caller's thread group. Caller holds proc_lock and makes
+ * it READY once the entry context is filled in.
+ */
+static process_t *process_alloc(const char *name) {
     int slot = -1;
     for (int i = 0; i < MAX_PROCESSES; i++) {
-        if (proc_table[i].state == PROC_UNUSED) {
+        if (slot_free(&proc_table[i])) {
             slot = i;
             break;
         }
     }
-    
-    if (slot == -1) return -1;
+    if (slot == -1) return NULL;
     
     process_t *proc = &proc_table[slot];
+    process_t *parent = process_current();
     proc->pid = next_pid++;
-    proc->ppid = current_pid;
-    proc->state = PROC_READY;
+    proc->tgid = proc->pid;
+    proc->ppid = parent ? parent->tgid : 0;
+    proc->flags = 0;
+    proc->clear_tid = NULL;
+    proc->timer_slack = parent ? parent->timer_slack : timer_ns_to_ticks(CONFIG_TIMER_SLACK_NS);
     
     int i;
     for (i = 0; i < PROC_NAME_LEN - 1 && name[i]; i++) {
@@ -65,43 +335,236 @@ int process_create(const char *name, void (*entry)(void)) {
     }
     proc->name[i] = '\0';
     
-    static uint8_t stacks[MAX_PROCESSES][STACK_SIZE];
+    static uint8_t stacks[MAX_PROCESSES][STACK_SIZE] __noinit;
     proc->stack = stacks[slot];
+    for (int j = 0; j < 32; j++) {
+        proc->context.regs[j] = 0;
+    }
+
+    proc->ring = NULL;
+    proc->ring_done = 0;
+    proc->futex_next = NULL;
+    timer_cancel(&proc->timeout);
+    proc->wait_deadline = 0;
+    proc->restart = 0;
+    proc->in_wait = 0;
+    proc->cancel_wait = NULL;
+    proc->wait_obj = NULL;
+    proc->sig_pending = 0;
+    proc->sig_blocked = 0;
+    for (int j = 0; j < NSIG; j++) {
+        proc->sigactions[j] = (struct sigaction){0};
+    }
+    proc->sigreturn_pending = 0;
+    proc->start_time = read_time();
+    proc->cpu_time = 0;
+    // Never inherited: a second deadline task would need admitting
+    proc->policy = SCHED_NORMAL;
+    timer_cancel(&proc->dl.timer);
+    proc->dl = (struct sched_dl){0};
+    return proc;
+}
 
+// Only schedulable once fully set up. Caller holds proc_lock.
+static int process_start(process_t *proc) {
+    proc->state = PROC_READY;
+    runq_push(proc);
+    trace(TRACE_PROC_CREATE, proc->pid, proc->ppid);
+    return proc->pid;
+}
+
+int process_create(const char *name, void (*entry)(void)) {
+    uint64_t flags = spin_lock_irqsave(&proc_lock);
+    process_t *proc = process_alloc(name);
+    if (!proc) {
+        spin_unlock_irqrestore(&proc_lock, flags);
+        return -1;
+    }
+    
     proc->context.pc = (uint64_t)entry;
     proc->context.sp = (uint64_t)(proc->stack + STACK_SIZE);
+    proc->context.regs[2] = proc->context.sp;
+    proc->context.regs[10] = (uint64_t)&vdso_page;
+    int pid = process_start(proc);
+    spin_unlock_irqrestore(&proc_lock, flags);
+    
+    pr_debug("Created process '%s' (PID %d)\n", proc->name, pid);
+    return pid;
+}
 
-    for (int j = 0; j < 16; j++) {
-        proc->fds[j] = -1;
+// Returned into when a clone()d thread's function returns; trap.S
+extern void thread_trampoline(void);
+
+/*
+ * Starts fn(arg) on the caller-supplied stack, running U-mode code like
+ * the caller. With CLONE_THREAD the new context joins the caller's
+ * thread group and inherits its signal state; otherwise it is a new
+ * process whose parent is the caller's group. Returns the new thread id.
+ */
+int process_clone(uint64_t clone_flags, void (*fn)(void *), void *stack, void *arg,
+                  void *tls, uint32_t *ctid) {
+    process_t *self = process_current();
+    if (!self || !fn || !stack || ((uint64_t)stack & 15)) return -1;
+    
+    uint64_t flags = spin_lock_irqsave(&proc_lock);
+    process_t *proc = process_alloc(self->name);
+    if (!proc) {
+        spin_unlock_irqrestore(&proc_lock, flags);
+        return -1;
     }
     
-    printk("Created process '%s' (PID %d)\n", proc->name, proc->pid);
-    return proc->pid;
+    if (clone_flags & CLONE_THREAD) {
+        proc->tgid = self->tgid;
+        proc->ppid = self->ppid;
+        proc->sig_blocked = self->sig_blocked;
+        for (int j = 0; j < NSIG; j++) {
+            proc->sigactions[j] = self->sigactions[j];
+        }
+    }
+    if (clone_flags & CLONE_CHILD_CLEARTID) {
+        proc->clear_tid = ctid;
+    }
+    
+    proc->context.pc = (uint64_t)fn;
+    proc->context.sp = (uint64_t)stack;
+    proc->context.regs[1] = (uint64_t)thread_trampoline;
+    proc->context.regs[2] = proc->context.sp;
+    // The caller's tp is parked in the hart struct for the syscall
+    proc->context.regs[4] = clone_flags & CLONE_SETTLS ? (uint64_t)tls : this_hart()->user_tp;
+    proc->context.regs[10] = (uint64_t)arg;
+    int tid = process_start(proc);
+    spin_unlock_irqrestore(&proc_lock, flags);
+    
+    pr_debug("Cloned thread %d of group %d\n", tid, proc->tgid);
+    return tid;
+}
+
+// Lets any thread of the parent blocked in process_wait retry and reap child
+static void process_wake_parent(process_t *child) {
+    for (int i = 0; i < MAX_PROCESSES; i++) {
+        process_t *p = &proc_table[i];
+        if (p->tgid == child->ppid && p->state != PROC_UNUSED && p->in_wait) {
+            p->in_wait = 0;
+            process_wake_restart(p);
+        }
+    }
+}
+
+// Threads of tgid that have not exited yet. Caller holds proc_lock.
+static int group_live(int tgid) {
+    int n = 0;
+    for (int i = 0; i < MAX_PROCESSES; i++) {
+        proc_state_t s = proc_table[i].state;
+        if (proc_table[i].tgid == tgid && s != PROC_UNUSED && s != PROC_ZOMBIE) {
+            n++;
+        }
+    }
+    return n;
 }
 
 void process_exit(int code) {
     process_t *proc = process_current();
     if (!proc) return;
     
-    printk("Process %d ('%s') exiting with code %d\n", proc->pid, proc->name, code);
+    pr_info("Process %d ('%s') exiting with code %d\n", proc->pid, proc->name, code);
+    
+#ifdef CONFIG_POWEROFF_ON_EXIT
+    // Unattended runs (CI, benchmarks) end when init does
+    if (proc->pid == 1) {
+        kernel_poweroff(code);
+    }
+#endif
+    
+    process_terminate(proc, code);
+}
+
+void process_exit_group(int code) {
+    process_t *proc = process_current();
+    if (!proc) return;
+    
+#ifdef CONFIG_POWEROFF_ON_EXIT
+    if (proc->tgid == 1) {
+        kernel_poweroff(code);
+    }
+#endif
     
+    process_terminate_group(proc, code);
+}
+
+/*
+ * Turns proc into a zombie from any state, including blocked elsewhere.
+ * Only the thread group leader is reaped by process_wait, and only once
+ * every other thread is gone; the others free their slot on their own.
+ */
+void process_terminate(process_t *proc, int code) {
+    uint64_t flags = spin_lock_irqsave(&proc_lock);
+    if (proc->state == PROC_ZOMBIE || proc->state == PROC_UNUSED) {
+        spin_unlock_irqrestore(&proc_lock, flags);
+        return;
+    }
     proc->state = PROC_ZOMBIE;
     proc->exit_code = code;
+    dl_leave(proc);
+    trace(TRACE_PROC_EXIT, proc->pid, code);
+    process_t *leader = process_get(proc->tgid);
+    int group_done = !group_live(proc->tgid) && leader && leader->state == PROC_ZOMBIE;
+    spin_unlock_irqrestore(&proc_lock, flags);
+    
+    timer_cancel(&proc->timeout);
+    if (proc->cancel_wait) {
+        proc->cancel_wait(proc);
+        proc->cancel_wait = NULL;
+    }
+    proc->in_wait = 0;
+    proc->sig_pending = 0;
+    
+    // How a joining thread learns this one is gone
+    if (proc->clear_tid) {
+        __atomic_store_n(proc->clear_tid, 0, __ATOMIC_RELEASE);
+        futex_wake(proc->clear_tid, 1);
+        proc->clear_tid = NULL;
+    }
+    perf_release_process(proc->pid);
+    
+    if (group_done) {
+        shm_release_process(proc->tgid);
+        process_wake_parent(leader);
+    }
     
-    process_t *parent = process_get(proc->ppid);
-    if (parent && parent->state == PROC_BLOCKED) {
-        parent->state = PROC_READY;
+    if (proc == process_current()) {
+        process_yield();
     }
+}
 
-    process_yield();
+// Fatal signals and exit_group take every thread, the caller's own last
+void process_terminate_group(process_t *proc, int code) {
+    process_t *self = process_current();
+    int tgid = proc->tgid;
+    for (int i = 0; i < MAX_PROCESSES; i++) {
+        process_t *t = &proc_table[i];
+        if (t->tgid == tgid && t != self && t->state != PROC_UNUSED) {
+            process_terminate(t, code);
+        }
+    }
+    if (self && self->tgid == tgid) {
+        process_terminate(self, code);
+    }
 }
 
 int process_wait(int *status) {
     process_t *proc = process_current();
     if (!proc) return -1;
     
+    uint64_t flags = spin_lock_irqsave(&proc_lock);
+    int has_children = 0;
     for (int i = 0; i < MAX_PROCESSES; i++) {
-        if (proc_table[i].ppid == proc->pid && proc_table[i].state == PROC_ZOMBIE) {
+        // Children are whole processes, stood for by their leaders
+        if (proc_table[i].ppid != proc->tgid || proc_table[i].state == PROC_UNUSED ||
+            proc_table[i].pid != proc_table[i].tgid) {
+            continue;
+        }
+        has_children = 1;
+        if (proc_table[i].state == PROC_ZOMBIE && !group_live(proc_table[i].tgid)) {
             int child_pid = proc_table[i].pid;
             if (status) {
                 *status = proc_table[i].exit_code;
@@ -109,40 +572,236 @@ int process_wait(int *status) {
 
             proc_table[i].state = PROC_UNUSED;
             proc_table[i].pid = 0;
+            spin_unlock_irqrestore(&proc_lock, flags);
             
             return child_pid;
         }
     }
 
+    if (!has_children) {
+        spin_unlock_irqrestore(&proc_lock, flags);
+        return -1;
+    }
+
+    // An exiting child wakes us to retry. Blocking under the same lock
+    // hold as the scan means a child exiting right now can't be missed.
+    proc->in_wait = 1;
     proc->state = PROC_BLOCKED;
-    process_yield();
+    spin_unlock_irqrestore(&proc_lock, flags);
+    process_block_wait(proc);
     
     return -1;
 }
 
 void process_yield(void) {
+    struct hart *h = this_hart();
+    uint64_t flags = spin_lock_irqsave(&proc_lock);
+    uint64_t now = read_time();
     process_t *current = process_current();
+    if (current && current->policy == SCHED_DEADLINE) {
+        dl_charge(current, now);
+    }
     if (current && current->state == PROC_RUNNING) {
         current->state = PROC_READY;
+        runq_push(current);
     }
+    h->need_resched = 0;
 
-    int start = current_pid;
-    for (int i = 1; i <= MAX_PROCESSES; i++) {
-        int idx = (start + i) % MAX_PROCESSES;
-        if (proc_table[idx].state == PROC_READY) {
-            current_pid = proc_table[idx].pid;
-            proc_table[idx].state = PROC_RUNNING;
-            return;
+    process_t *next = dl_pick();
+    if (!next) {
+        next = runq_pop();
+    }
+    // A throttled deadline task keeps a hart that has nothing else to do
+    if (!next && current && current->state == PROC_READY) {
+        next = current;
+    }
+    if (next) {
+        if (next != current) {
+            trace(TRACE_SCHED_SWITCH, current ? current->pid : 0, next->pid);
+        }
+        next->state = PROC_RUNNING;
+        h->current_pid = next->pid;
+        vdso_set_pid(next->tgid);
+        if (next->policy == SCHED_DEADLINE) {
+            dl_start(next, now);
         }
     }
+    spin_unlock_irqrestore(&proc_lock, flags);
+}
+
+/*
+ * Blocks the current process until process_wake. If nothing else can run,
+ * idles here with interrupts on so a timer or device can wake someone.
+ * Returns the wake value when the caller is still the running process;
+ * otherwise the switch delivers it through the saved context.
+ */
+uint64_t process_block(void) {
+    process_t *proc = process_current();
+    if (!proc) return -1;
+    
+    uint64_t flags = spin_lock_irqsave(&proc_lock);
+    proc->state = PROC_BLOCKED;
+    spin_unlock_irqrestore(&proc_lock, flags);
     
-    if (current && current->state == PROC_READY) {
-        current->state = PROC_RUNNING;
+    return process_block_wait(proc);
+}
+
+// Second half of process_block for callers that set PROC_BLOCKED themselves
+static uint64_t process_block_wait(process_t *proc) {
+    process_yield();
+    
+    while (process_current() == proc && proc->state == PROC_BLOCKED) {
+        printk_flush();
+        tick_idle();
+        process_yield();
+    }
+    
+    return proc->context.regs[10];
+}
+
+/*
+ * A deadline task woken from an interrupt preempts on the trap exit.
+ * Otherwise the waker is in a syscall, and syscall_handler picks again
+ * on its way out.
+ */
+static void process_resched(void) {
+    if (this_hart()->need_resched && in_interrupt()) {
+        process_yield();
+    }
+}
+
+// ret becomes the blocked syscall's return value
+void process_wake(process_t *proc, uint64_t ret) {
+    uint64_t flags = spin_lock_irqsave(&proc_lock);
+    if (proc->state == PROC_BLOCKED) {
+        proc->context.regs[10] = ret;
+        proc->cancel_wait = NULL;
+        proc->state = PROC_READY;
+        runq_push(proc);
+        dl_wakeup(proc);
+    }
+    spin_unlock_irqrestore(&proc_lock, flags);
+    
+    process_resched();
+}
+
+// Wakes proc so that it re-issues the syscall it blocked in
+void process_wake_restart(process_t *proc) {
+    uint64_t flags = spin_lock_irqsave(&proc_lock);
+    if (proc->state == PROC_BLOCKED) {
+        proc->restart = 1;
+        proc->cancel_wait = NULL;
+        proc->state = PROC_READY;
+        runq_push(proc);
+        dl_wakeup(proc);
+    }
+    spin_unlock_irqrestore(&proc_lock, flags);
+    
+    process_resched();
+}
+
+// Aborts a blocking syscall with -1 so a signal can be delivered
+void process_interrupt(process_t *proc) {
+    if (proc->state != PROC_BLOCKED) return;
+    
+    timer_cancel(&proc->timeout);
+    if (proc->cancel_wait) {
+        proc->cancel_wait(proc);
+    }
+    proc->in_wait = 0;
+    process_wake(proc, -1);
+}
+
+static void process_sleep_expired(struct timer *t) {
+    process_wake((process_t *)t->arg, 0);
+}
+
+int process_sleep(uint64_t deadline) {
+    process_t *proc = process_current();
+    if (!proc) return -1;
+    
+    if (deadline <= read_time()) return 0;
+    
+    timer_add_slack(&proc->timeout, deadline, proc->timer_slack, process_sleep_expired, proc);
+    return (int)process_block();
+}
+
+int process_switch_pending(void) {
+    struct hart *h = this_hart();
+    return h->current_pid != h->running_pid;
+}
+
+static void process_load_frame(struct trap_frame *tf) {
+    struct hart *h = this_hart();
+    uint64_t *gpr = &tf->x1;
+    process_t *prev = process_get(h->running_pid);
+    process_t *next = process_current();
+    if (!next) return;
+    
+    if (prev) {
+        for (int i = 1; i < 32; i++) {
+            prev->context.regs[i] = gpr[i - 1];
+        }
+        prev->context.sp = tf->x2;
+        prev->context.pc = tf->sepc;
+    }
+    
+    for (int i = 1; i < 32; i++) {
+        gpr[i - 1] = next->context.regs[i];
+    }
+    tf->x2 = next->context.sp;
+    tf->sepc = next->context.pc;
+    if (next->restart) {
+        next->restart = 0;
+        tf->sepc -= 4;
+    }
+    
+    // sret picks the privilege level, and kernel code wants tp = hart
+    if (next->flags & PROC_F_KTHREAD) {
+        tf->sstatus |= SSTATUS_SPP | SSTATUS_SPIE;
+        tf->x4 = (uint64_t)this_hart();
+    } else {
+        tf->sstatus = (tf->sstatus & ~SSTATUS_SPP) | SSTATUS_SPIE;
+    }
+    
+    perf_switch(prev, next);
+    h->running_pid = h->current_pid;
+    h->stats.switches++;
+}
+
+/*
+ * Called on the way out of a trap. If process_yield picked a different
+ * process, park the interrupted user context in its process_t and load
+ * the new one into the frame that trap.S is about to restore. Signals
+ * are delivered here too, since this is where the full user context of
+ * the process about to run is in the frame; a default action that
+ * kills it means picking someone else and going round again.
+ */
+void process_switch_frame(struct trap_frame *tf) {
+    // Only user and kthread contexts are switched; a trap taken in the
+    // kernel on behalf of a process leaves the switch to its next return
+    // to user mode.
+    if (tf->sstatus & SSTATUS_SPP) {
+        process_t *running = process_get(this_hart()->running_pid);
+        if (!running || !(running->flags & PROC_F_KTHREAD)) return;
+    }
+    
+    for (;;) {
+        if (process_switch_pending()) {
+            process_load_frame(tf);
+        }
+        
+        process_t *proc = process_current();
+        if (!proc || proc->pid != this_hart()->running_pid) return;
+        if (signal_work_pending(proc)) {
+            signal_handle(proc, tf);
+        }
+        if (!process_switch_pending()) return;
     }
 }
 
 int process_fork(void) {
-    printk("[fork] Not fully implemented (requires scheduler)\n");
+    pr_debug("[fork] Not fully implemented (requires scheduler)\n");
     return -1;
 }
 
@@ -150,55 +809,200 @@ int process_exec(const char *path) {
     process_t *proc = process_current();
     if (!proc) return -1;
     
-    printk("[exec] Process %d executing '%s'\n", proc->pid, path);
-    printk("[exec] ERROR: exec not fully implemented\n");
-    printk("[exec] Would load: %s\n", path);
+    pr_debug("[exec] Process %d executing '%s'\n", proc->pid, path);
+    pr_warn("[exec] exec not implemented, can't load %s\n", path);
     
     return -1;
 }
 
 int process_kill(int pid, int sig) {
-    printk("[kill] Attempting to send signal %d to PID %d\n", sig, pid);
-
     process_t *target = process_get(pid);
     if (!target) {
-        printk("[kill] ERROR: Process %d not found\n", pid);
+        pr_debug("[kill] Process %d not found\n", pid);
+        return -1;
+    }
+    
+    if (target->flags & PROC_F_KTHREAD) return -1;
+    
+    // Signal 0 only probes for existence
+    if (sig == 0) return 0;
+    
+    return signal_send(target, sig);
+}
+
+/*
+ * A kthread is entered by sret with interrupts on. Like all kernel code
+ * it then runs with them off, and is only switched out where it opens
+ * a window for the scheduling interrupt: in kthread_park, or for good
+ * when fn returns.
+ */
+static void kthread_start(void (*fn)(void *), void *arg) {
+    irq_save();
+    fn(arg);
+    
+    process_t *self = process_current();
+    pr_debug("kthread '%s' (PID %d) returned\n", self->name, self->pid);
+    process_terminate(self, 0);
+    for (;;) {
+        sched_trap();
+        idle_wait();
+        process_yield();
+    }
+}
+
+int kthread_create(const char *name, void (*fn)(void *), void *arg) {
+    uint64_t flags = spin_lock_irqsave(&proc_lock);
+    process_t *proc = process_alloc(name);
+    if (!proc) {
+        spin_unlock_irqrestore(&proc_lock, flags);
         return -1;
     }
     
-    printk("[kill] Found target process '%s' (PID %d)\n", target->name, target->pid);
+    proc->flags = PROC_F_KTHREAD;
+    proc->ppid = 0;
+    proc->sig_blocked = ~0ULL;
+    proc->context.pc = (uint64_t)kthread_start;
+    proc->context.sp = (uint64_t)(proc->stack + STACK_SIZE);
+    proc->context.regs[2] = proc->context.sp;
+    proc->context.regs[10] = (uint64_t)fn;
+    proc->context.regs[11] = (uint64_t)arg;
+    int pid = process_start(proc);
+    spin_unlock_irqrestore(&proc_lock, flags);
+    
+    pr_debug("Created kthread '%s' (PID %d)\n", proc->name, pid);
+    return pid;
+}
 
-    switch (sig) {
-        case 9:
-            printk("[kill] SIGKILL: Terminating process %d\n", pid);
-            target->state = PROC_ZOMBIE;
-            target->exit_code = 128 + sig;
+/*
+ * First half of kthread_park. Call it while still holding the lock that
+ * guards the kthread's work, so a kthread_wake after the unlock can't be
+ * missed.
+ */
+void kthread_prepare_park(void) {
+    process_t *self = process_current();
+    uint64_t flags = spin_lock_irqsave(&proc_lock);
+    self->state = PROC_BLOCKED;
+    spin_unlock_irqrestore(&proc_lock, flags);
+}
 
-            process_t *parent = process_get(target->ppid);
-            if (parent && parent->state == PROC_BLOCKED) {
-                parent->state = PROC_READY;
-            }
+// Sleeps until kthread_wake, running or idling other work meanwhile
+void kthread_park(void) {
+    process_t *self = process_current();
+    while (self->state == PROC_BLOCKED) {
+        process_yield();
+        if (process_switch_pending()) {
+            // Resumes here once picked again
+            sched_trap();
+            continue;
+        }
+        tick_idle();
+    }
+}
+
+/*
+ * Queues proc ahead of everyone else. From an interrupt, the interrupted
+ * process is preempted too, so deferred work starts on the trap exit
+ * rather than whenever the current process next blocks.
+ */
+void kthread_wake(process_t *proc) {
+    uint64_t flags = spin_lock_irqsave(&proc_lock);
+    int woken = proc->state == PROC_BLOCKED;
+    if (woken) {
+        proc->state = PROC_READY;
+        runq_push_front(proc);
+    }
+    spin_unlock_irqrestore(&proc_lock, flags);
+    
+    if (woken && in_interrupt()) {
+        process_yield();
+    }
+}
+
+/*
+ * SCHED_DEADLINE needs runtime <= deadline <= period, and a set that
+ * still fits DL_BW_MAX; SCHED_NORMAL hands the bandwidth back. Kernel
+ * threads stay round robin.
+ */
+int process_sched_setattr(int pid, const struct sched_attr *attr) {
+    if (!attr || attr->size < sizeof(struct sched_attr)) return -1;
+    process_t *proc = pid ? process_get(pid) : process_current();
+    if (!proc || (proc->flags & PROC_F_KTHREAD) || proc->state == PROC_ZOMBIE) return -1;
+    
+    uint64_t runtime = attr->sched_runtime;
+    uint64_t deadline = attr->sched_deadline;
+    uint64_t period = attr->sched_period ? attr->sched_period : deadline;
+    if (attr->sched_policy == SCHED_DEADLINE &&
+        (runtime < DL_RUNTIME_MIN_NS || runtime > deadline || deadline > period ||
+         period > DL_PERIOD_MAX_NS)) {
+        return -1;
+    }
+    
+    int ret = 0;
+    uint64_t flags = spin_lock_irqsave(&proc_lock);
+    switch (attr->sched_policy) {
+        case SCHED_NORMAL:
+            dl_leave(proc);
             break;
-            
-        case 15:
-            printk("[kill] SIGTERM: Requesting termination of process %d\n", pid);
-            target->state = PROC_ZOMBIE;
-            target->exit_code = 128 + sig;
-            
-            process_t *parent2 = process_get(target->ppid);
-            if (parent2 && parent2->state == PROC_BLOCKED) {
-                parent2->state = PROC_READY;
-            }
+        case SCHED_DEADLINE:
+            ret = dl_admit(proc, timer_ns_to_ticks(runtime), timer_ns_to_ticks(deadline),
+                           timer_ns_to_ticks(period));
             break;
-            
-        case 0:
-            printk("[kill] Signal 0: Process %d exists\n", pid);
-            return 0;
-            
         default:
-            printk("[kill] Signal %d not implemented\n", sig);
-            return -1;
+            ret = -1;
+            break;
     }
+    spin_unlock_irqrestore(&proc_lock, flags);
+    return ret;
+}
+
+int process_sched_getattr(int pid, struct sched_attr *attr) {
+    if (!attr) return -1;
+    process_t *proc = pid ? process_get(pid) : process_current();
+    if (!proc) return -1;
     
+    uint64_t flags = spin_lock_irqsave(&proc_lock);
+    *attr = (struct sched_attr){ .size = sizeof(struct sched_attr),
+                                 .sched_policy = proc->policy };
+    if (proc->policy == SCHED_DEADLINE) {
+        attr->sched_runtime = timer_ticks_to_ns(proc->dl.runtime);
+        attr->sched_deadline = timer_ticks_to_ns(proc->dl.deadline);
+        attr->sched_period = timer_ticks_to_ns(proc->dl.period);
+    }
+    spin_unlock_irqrestore(&proc_lock, flags);
     return 0;
 }
+
+/*
+ * A deadline task yields to say its job is done: it gives up the rest
+ * of its budget and sleeps until its next period, idling here if there
+ * is nothing else to run. Anyone else goes to the back of the run queue.
+ */
+void process_sched_yield(void) {
+    process_t *proc = process_current();
+    uint64_t flags = spin_lock_irqsave(&proc_lock);
+    if (proc && proc->policy == SCHED_DEADLINE && proc->dl.on_cpu) {
+        proc->dl.yielded = 1;
+    }
+    spin_unlock_irqrestore(&proc_lock, flags);
+    
+    process_yield();
+    while (process_current() == proc && proc->policy == SCHED_DEADLINE && proc->dl.throttled) {
+        printk_flush();
+        tick_idle();
+        process_yield();
+    }
+}
+
+void process_dump_sched_stats(void) {
+    if (!dl_total_bw) return;
+    
+    printk("sched: deadline tasks hold %lu%% of a hart\n", (dl_total_bw * 100) >> DL_BW_SHIFT);
+    for (int i = 0; i < MAX_PROCESSES; i++) {
+        const process_t *p = &proc_table[i];
+        if (p->policy != SCHED_DEADLINE || p->state == PROC_UNUSED) continue;
+        printk("  pid %d '%s': %lu/%lu/%lu us, %lu misses, %lu overruns%s\n",
+               p->pid, p->name, timer_ticks_to_ns(p->dl.runtime) / 1000,
+               timer_ticks_to_ns(p->dl.deadline) / 1000, timer_ticks_to_ns(p->dl.period) / 1000,
+               p->dl.misses, p->dl.overruns, p->dl.throttled ? ", throttled" : "");
+    }
+}
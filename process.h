@@ -2,11 +2,70 @@
 #define PROCESS_H
 
 #include <stdint.h>
+#include "timer.h"
+#include "signal.h"
+
+struct io_ring;
+struct trap_frame;
 
 #define MAX_PROCESSES 64
 #define STACK_SIZE 8192
 #define PROC_NAME_LEN 32
 
+// clone() flags, as on Linux. Memory and descriptors are always shared
+// here (no MMU, one fd table), so CLONE_VM and CLONE_FILES are implied.
+#define CLONE_VM             0x00000100
+#define CLONE_FILES          0x00000400
+#define CLONE_THREAD         0x00010000
+#define CLONE_SETTLS         0x00080000
+#define CLONE_CHILD_CLEARTID 0x00200000
+
+// prctl() options, as on Linux; slack is in nanoseconds
+#define PR_SET_TIMERSLACK 29
+#define PR_GET_TIMERSLACK 30
+
+// sched_setattr() policies, as on Linux
+#define SCHED_NORMAL   0
+#define SCHED_DEADLINE 6
+
+/*
+ * sched_setattr() parameters in the layout of Linux's first version.
+ * Times are in nanoseconds, and a zero period means the deadline.
+ */
+struct sched_attr {
+    uint32_t size;
+    uint32_t sched_policy;
+    uint64_t sched_flags;
+    int32_t sched_nice;
+    uint32_t sched_priority;
+    uint64_t sched_runtime;
+    uint64_t sched_deadline;
+    uint64_t sched_period;
+};
+
+// SCHED_DEADLINE state; times are in time CSR ticks
+struct sched_dl {
+    uint64_t runtime;
+    uint64_t deadline;
+    uint64_t period;
+    // runtime / period, fixed point, as counted by admission control
+    uint64_t bw;
+    // The current job: its absolute deadline and what is left of its budget
+    uint64_t abs_deadline;
+    uint64_t budget;
+    uint64_t exec_start;
+    int on_cpu;
+    int throttled;
+    int yielded;
+    // Budget enforcement while running, replenishment while throttled
+    struct timer timer;
+    uint64_t misses;
+    uint64_t overruns;
+};
+
+// process_t.flags
+#define PROC_F_KTHREAD 0x1
+
 typedef enum {
     PROC_UNUSED = 0,
     PROC_RUNNING,
@@ -21,9 +80,15 @@ typedef struct {
     uint64_t sp;
 } context_t;
 
+/*
+ * One schedulable thread. Threads of a process share its tgid, which is
+ * the leader's pid and what getpid() reports; pid is the thread id.
+ */
 typedef struct process {
     int pid;
+    int tgid;
     int ppid;
+    int flags;
     proc_state_t state;
     char name[PROC_NAME_LEN];
     
@@ -31,25 +96,76 @@ typedef struct process {
     uint8_t *stack;
     
     int exit_code;
+    // CLONE_CHILD_CLEARTID: zeroed and futex-woken when the thread exits
+    uint32_t *clear_tid;
 
-    int fds[16];
+    struct io_ring *ring;
+    // sqes a ring_enter completed before blocking, counted by its restart
+    uint32_t ring_done;
+
+    uint64_t futex_key;
+    struct process *futex_next;
+
+    struct timer timeout;
+    // How late timeout may fire so it can share a wakeup (prctl)
+    uint64_t timer_slack;
+    // Absolute end of a timed wait that restarts itself, kept across restarts
+    uint64_t wait_deadline;
+    int restart;
+    int in_wait;
+    int on_runq;
+
+    // Undoes whatever queue a blocked process sits on, for interruption
+    void (*cancel_wait)(struct process *proc);
+    void *wait_obj;
+
+    uint64_t sig_pending;
+    uint64_t sig_blocked;
+    struct sigaction sigactions[NSIG];
+    int sigreturn_pending;
 
     uint64_t start_time;
     uint64_t cpu_time;
+
+    int policy;
+    struct sched_dl dl;
 } process_t;
 
 extern process_t proc_table[MAX_PROCESSES];
-extern int current_pid;
 
 void process_init(void);
 int process_create(const char *name, void (*entry)(void));
+int process_clone(uint64_t flags, void (*fn)(void *), void *stack, void *arg,
+                  void *tls, uint32_t *ctid);
 void process_exit(int code);
+void process_exit_group(int code);
 int process_fork(void);
 int process_exec(const char *path);
 int process_kill(int pid, int sig);
 int process_wait(int *status);
 void process_yield(void);
+uint64_t process_block(void);
+void process_wake(process_t *proc, uint64_t ret);
+void process_wake_restart(process_t *proc);
+void process_interrupt(process_t *proc);
+void process_terminate(process_t *proc, int code);
+void process_terminate_group(process_t *proc, int code);
+int process_sleep(uint64_t deadline);
 process_t *process_current(void);
 process_t *process_get(int pid);
+int process_switch_pending(void);
+void process_switch_frame(struct trap_frame *tf);
+
+// Scheduling class, in the style of sched_setattr(2); pid 0 is the caller
+int process_sched_setattr(int pid, const struct sched_attr *attr);
+int process_sched_getattr(int pid, struct sched_attr *attr);
+void process_sched_yield(void);
+void process_dump_sched_stats(void);
+
+// Kernel threads: S-mode contexts scheduled like processes
+int kthread_create(const char *name, void (*fn)(void *), void *arg);
+void kthread_prepare_park(void);
+void kthread_park(void);
+void kthread_wake(process_t *proc);
 
 #endif
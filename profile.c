@@ -0,0 +1,175 @@
+#include "profile.h"
+#include "trap.h"
+#include "timer.h"
+#include "hart.h"
+#include "boot.h"
+#include "printk.h"
+#include "riscv.h"
+
+/*
+ * Each hart appends to its own buffer from its timer interrupt, so no
+ * locking is needed; readers run with interrupts off on the kernel side
+ * of a syscall. A full buffer drops new samples rather than overwriting,
+ * which keeps what was read consistent with the dropped count.
+ */
+struct prof_buf {
+    uint32_t head;
+    uint32_t tail;
+    uint64_t dropped;
+    int due;
+};
+
+static struct prof_buf prof_bufs[MAX_HARTS];
+static struct prof_sample prof_samples[MAX_HARTS][PROF_SAMPLES] __noinit;
+
+static struct timer prof_timer;
+static uint64_t prof_period;
+static int prof_running;
+static uint64_t prof_hz;
+static uint64_t prof_total;
+
+// Everything the kernel and user code touch lies inside the image
+extern char _start[], __kernel_end[];
+
+static int fp_valid(uint64_t fp, uint64_t prev) {
+    return (fp & 7) == 0 && fp > prev &&
+           fp >= (uint64_t)_start + 16 && fp <= (uint64_t)__kernel_end;
+}
+
+/*
+ * With -fno-omit-frame-pointer, s0 holds the caller's sp at entry, the
+ * return address sits at s0 - 8 and the caller's s0 at s0 - 16. The
+ * chain has to climb strictly upwards, so a corrupt s0 can't loop.
+ */
+static int backtrace(uint64_t fp, uint64_t *frames) {
+    int depth = 0;
+    uint64_t prev = 0;
+    
+    while (depth < PROF_DEPTH && fp_valid(fp, prev)) {
+        uint64_t ra = ((uint64_t *)fp)[-1];
+        if (!ra) break;
+        frames[depth++] = ra;
+        prev = fp;
+        fp = ((uint64_t *)fp)[-2];
+    }
+    return depth;
+}
+
+static void prof_timer_fn(struct timer *t) {
+    prof_bufs[hart_id()].due = 1;
+    if (!prof_running) return;
+    
+    // Keep the phase, but don't try to catch up after a long stall
+    uint64_t next = t->expires + prof_period;
+    if (next <= read_time()) {
+        next = read_time() + prof_period;
+    }
+    timer_add(t, next, prof_timer_fn, 0);
+}
+
+// Called from the timer interrupt after the wheel has run
+void profile_tick(struct trap_frame *tf) {
+    struct prof_buf *b = &prof_bufs[hart_id()];
+    if (!b->due) return;
+    b->due = 0;
+    
+    if (b->head - b->tail >= PROF_SAMPLES) {
+        b->dropped++;
+        return;
+    }
+    
+    struct prof_sample *s = &prof_samples[hart_id()][b->head % PROF_SAMPLES];
+    s->time = read_time();
+    s->pc = tf->sepc;
+    s->pid = this_hart()->running_pid;
+    s->mode = tf->sstatus & SSTATUS_SPP ? PROF_MODE_KERNEL : PROF_MODE_USER;
+    s->hart = hart_id();
+    s->depth = backtrace(tf->x8, s->frames);
+    b->head++;
+    prof_total++;
+}
+
+static void prof_start(uint64_t hz) {
+    if (hz == 0) hz = PROF_DEFAULT_HZ;
+    if (hz > PROF_MAX_HZ) hz = PROF_MAX_HZ;
+    
+    for (int i = 0; i < MAX_HARTS; i++) {
+        prof_bufs[i].head = prof_bufs[i].tail = 0;
+        prof_bufs[i].dropped = 0;
+        prof_bufs[i].due = 0;
+    }
+    prof_hz = hz;
+    prof_period = TIMEBASE_FREQ / hz;
+    prof_running = 1;
+    timer_add(&prof_timer, read_time() + prof_period, prof_timer_fn, 0);
+}
+
+static void prof_stop(void) {
+    prof_running = 0;
+    timer_cancel(&prof_timer);
+}
+
+// Drains up to max unread samples into buf, hart by hart
+static int prof_read(struct prof_sample *buf, uint64_t max) {
+    uint64_t n = 0;
+    for (int i = 0; i < MAX_HARTS && n < max; i++) {
+        struct prof_buf *b = &prof_bufs[i];
+        while (b->tail != b->head && n < max) {
+            buf[n++] = prof_samples[i][b->tail % PROF_SAMPLES];
+            b->tail++;
+        }
+    }
+    return (int)n;
+}
+
+/*
+ * Text form for tools/profsym.py: one line per sample with hart, pid,
+ * u/k, time, pc and the return addresses, all between markers.
+ */
+static int prof_dump(void) {
+    int n = 0;
+    uint64_t dropped = 0;
+    for (int i = 0; i < MAX_HARTS; i++) {
+        dropped += prof_bufs[i].dropped;
+    }
+    
+    printk("PROFILE-BEGIN hz=%lu dropped=%lu\n", prof_hz, dropped);
+    for (int i = 0; i < MAX_HARTS; i++) {
+        struct prof_buf *b = &prof_bufs[i];
+        for (; b->tail != b->head; b->tail++, n++) {
+            const struct prof_sample *s = &prof_samples[i][b->tail % PROF_SAMPLES];
+            printk("P %u %d %c %lu %lx", s->hart, s->pid,
+                   s->mode == PROF_MODE_KERNEL ? 'k' : 'u', s->time, s->pc);
+            for (int j = 0; j < s->depth; j++) {
+                printk(" %lx", s->frames[j]);
+            }
+            printk("\n");
+        }
+    }
+    printk("PROFILE-END samples=%d\n", n);
+    return n;
+}
+
+int profile_ctl(int cmd, uint64_t arg, void *buf) {
+    switch (cmd) {
+        case PROF_START:
+            prof_start(arg);
+            return 0;
+        case PROF_STOP:
+            prof_stop();
+            return 0;
+        case PROF_READ:
+            if (!buf) return -1;
+            return prof_read((struct prof_sample *)buf, arg);
+        case PROF_DUMP:
+            return prof_dump();
+        default:
+            return -1;
+    }
+}
+
+void profile_dump_stats(void) {
+    if (!prof_total) return;
+    printk("profile: %lu samples at %lu Hz%s\n", prof_total, prof_hz,
+           prof_running ? ", running" : "");
+}
@@ -0,0 +1,41 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+
+struct trap_frame;
+
+#define PROF_DEPTH      6
+#define PROF_SAMPLES    1024
+#define PROF_DEFAULT_HZ 1000
+#define PROF_MAX_HZ     10000
+
+// profile() commands
+#define PROF_START 0
+#define PROF_STOP  1
+#define PROF_READ  2
+#define PROF_DUMP  3
+
+#define PROF_MODE_USER   0
+#define PROF_MODE_KERNEL 1
+
+/*
+ * One timer-interrupt sample: the interrupted pc plus return addresses
+ * from the frame-pointer chain, innermost first.
+ */
+struct prof_sample {
+    uint64_t time;
+    uint64_t pc;
+    uint64_t frames[PROF_DEPTH];
+    int32_t pid;
+    uint8_t mode;
+    uint8_t hart;
+    uint8_t depth;
+    uint8_t pad;
+};
+
+int profile_ctl(int cmd, uint64_t arg, void *buf);
+void profile_tick(struct trap_frame *tf);
+void profile_dump_stats(void);
+
+#endif
@@ -0,0 +1,70 @@
+#include "ring.h"
+#include "process.h"
+#include "syscall.h"
+#include <stddef.h>
+
+int ring_setup(struct io_ring *ring) {
+    process_t *proc = process_current();
+    if (!proc) return -1;
+    
+    if (ring && ((uint64_t)ring & 7)) {
+        return -1;
+    }
+    
+    if (ring) {
+        ring->sq_head = 0;
+        ring->sq_tail = 0;
+        ring->cq_head = 0;
+        ring->cq_tail = 0;
+    }
+    
+    proc->ring = ring;
+    return 0;
+}
+
+/*
+ * An sqe that blocks (a console read with no line yet) ends the batch
+ * without a completion and stays at sq_head. The wakeup restarts
+ * ring_enter, which runs it again and carries on from there; what was
+ * done before the block still counts against to_submit.
+ */
+int ring_enter(uint32_t to_submit) {
+    process_t *proc = process_current();
+    if (!proc || !proc->ring) return -1;
+    
+    struct io_ring *ring = proc->ring;
+    uint32_t sq_head = ring->sq_head;
+    uint32_t sq_tail = __atomic_load_n(&ring->sq_tail, __ATOMIC_ACQUIRE);
+    uint32_t cq_tail = ring->cq_tail;
+    int submitted = proc->ring_done;
+    proc->ring_done = 0;
+    
+    while (sq_head != sq_tail && (uint32_t)submitted < to_submit) {
+        // Stop rather than overwrite completions user space has not reaped
+        uint32_t cq_head = __atomic_load_n(&ring->cq_head, __ATOMIC_ACQUIRE);
+        if (cq_tail - cq_head >= RING_ENTRIES) {
+            break;
+        }
+        
+        const struct io_sqe *sqe = &ring->sqes[sq_head & RING_MASK];
+        struct io_cqe *cqe = &ring->cqes[cq_tail & RING_MASK];
+        
+        int64_t res = syscall_batched(sqe->syscall, sqe->args);
+        // Still asleep, or already woken in place and due to re-issue
+        if (proc->state == PROC_BLOCKED || proc->restart) {
+            proc->ring_done = submitted;
+            break;
+        }
+        cqe->user_data = sqe->user_data;
+        cqe->res = res;
+        
+        sq_head++;
+        cq_tail++;
+        submitted++;
+    }
+    
+    __atomic_store_n(&ring->sq_head, sq_head, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->cq_tail, cq_tail, __ATOMIC_RELEASE);
+    
+    return submitted;
+}
@@ -0,0 +1,39 @@
+#ifndef RING_H
+#define RING_H
+
+#include <stdint.h>
+
+#define RING_ENTRIES 64
+#define RING_MASK (RING_ENTRIES - 1)
+
+/*
+ * Shared between a process and the kernel. User space fills sqes[] and
+ * advances sq_tail; the kernel consumes up to sq_tail on ring_enter and
+ * posts one cqe per sqe, advancing cq_tail. User space reaps completions
+ * by advancing cq_head, without trapping. Indices are free-running and
+ * masked with RING_MASK on access.
+ */
+struct io_sqe {
+    uint64_t syscall;
+    uint64_t args[3];
+    uint64_t user_data;
+};
+
+struct io_cqe {
+    uint64_t user_data;
+    int64_t res;
+};
+
+struct io_ring {
+    uint32_t sq_head;
+    uint32_t sq_tail;
+    uint32_t cq_head;
+    uint32_t cq_tail;
+    struct io_sqe sqes[RING_ENTRIES];
+    struct io_cqe cqes[RING_ENTRIES];
+};
+
+int ring_setup(struct io_ring *ring);
+int ring_enter(uint32_t to_submit);
+
+#endif
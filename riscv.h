@@ -0,0 +1,71 @@
+#ifndef RISCV_H
+#define RISCV_H
+
+#include <stdint.h>
+
+// time CSR frequency on QEMU virt
+#define TIMEBASE_FREQ 10000000UL
+
+#define SSTATUS_SIE  0x2UL
+#define SSTATUS_SPIE 0x20UL
+#define SSTATUS_SPP  0x100UL
+#define SIP_SSIP     (1UL << 1)
+
+#ifdef __riscv
+
+static inline uint64_t read_cycle(void) {
+    uint64_t c;
+    asm volatile("rdcycle %0" : "=r"(c));
+    return c;
+}
+
+static inline uint64_t read_time(void) {
+    uint64_t t;
+    asm volatile("rdtime %0" : "=r"(t));
+    return t;
+}
+
+// Disables S-mode interrupts, returning whether they were on
+static inline uint64_t irq_save(void) {
+    uint64_t s;
+    asm volatile("csrrc %0, sstatus, %1" : "=r"(s) : "i"(SSTATUS_SIE) : "memory");
+    return s & SSTATUS_SIE;
+}
+
+static inline void irq_restore(uint64_t flags) {
+    if (flags) {
+        asm volatile("csrs sstatus, %0" :: "i"(SSTATUS_SIE) : "memory");
+    }
+}
+
+// Sleeps until an interrupt, letting it be taken, then masks them again
+static inline void idle_wait(void) {
+    asm volatile("csrsi sstatus, 0x2\n"
+                 "wfi\n"
+                 "csrci sstatus, 0x2" ::: "memory");
+}
+
+/*
+ * Raises a software interrupt on this hart and lets it be taken at once,
+ * so kernel code with no trap of its own to return through (a kthread)
+ * still reaches the trap exit path that switches processes.
+ */
+static inline void sched_trap(void) {
+    asm volatile("csrs sip, %0\n"
+                 "csrsi sstatus, 0x2\n"
+                 "csrci sstatus, 0x2" :: "r"(SIP_SSIP) : "memory");
+}
+
+#else
+
+// Host build (host/): host/shim.c provides these
+uint64_t read_cycle(void);
+uint64_t read_time(void);
+uint64_t irq_save(void);
+void irq_restore(uint64_t flags);
+void idle_wait(void);
+void sched_trap(void);
+
+#endif
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef SBI_H
+#define SBI_H
+
+#include <stdint.h>
+
+#define SBI_EXT_LEGACY_PUTCHAR 0x01
+#define SBI_EXT_BASE           0x10
+#define SBI_EXT_TIME           0x54494D45
+#define SBI_EXT_DBCN           0x4442434E
+#define SBI_EXT_SRST           0x53525354
+#define SBI_EXT_PMU            0x504D55
+
+#define SBI_BASE_PROBE_EXT 3
+#define SBI_DBCN_WRITE     0
+#define SBI_SRST_RESET     0
+
+#define SBI_PMU_NUM_COUNTERS    0
+#define SBI_PMU_COUNTER_INFO    1
+#define SBI_PMU_CONFIG_MATCH    2
+#define SBI_PMU_COUNTER_START   3
+#define SBI_PMU_COUNTER_STOP    4
+#define SBI_PMU_COUNTER_FW_READ 5
+
+#define SBI_SRST_SHUTDOWN       0
+#define SBI_SRST_REASON_NONE    0
+#define SBI_SRST_REASON_FAILURE 1
+
+#define SBI_SUCCESS 0
+
+struct sbiret {
+    long error;
+    long value;
+};
+
+static inline struct sbiret sbi_ecall(uint64_t ext, uint64_t fid,
+                                      uint64_t arg0, uint64_t arg1, uint64_t arg2) {
+    register uint64_t a0 asm("a0") = arg0;
+    register uint64_t a1 asm("a1") = arg1;
+    register uint64_t a2 asm("a2") = arg2;
+    register uint64_t a6 asm("a6") = fid;
+    register uint64_t a7 asm("a7") = ext;
+    asm volatile("ecall"
+                 : "+r"(a0), "+r"(a1)
+                 : "r"(a2), "r"(a6), "r"(a7)
+                 : "memory");
+    struct sbiret ret = { (long)a0, (long)a1 };
+    return ret;
+}
+
+// For the few calls (PMU) that take more than three arguments
+static inline struct sbiret sbi_ecall5(uint64_t ext, uint64_t fid, uint64_t arg0,
+                                       uint64_t arg1, uint64_t arg2, uint64_t arg3,
+                                       uint64_t arg4) {
+    register uint64_t a0 asm("a0") = arg0;
+    register uint64_t a1 asm("a1") = arg1;
+    register uint64_t a2 asm("a2") = arg2;
+    register uint64_t a3 asm("a3") = arg3;
+    register uint64_t a4 asm("a4") = arg4;
+    register uint64_t a6 asm("a6") = fid;
+    register uint64_t a7 asm("a7") = ext;
+    asm volatile("ecall"
+                 : "+r"(a0), "+r"(a1)
+                 : "r"(a2), "r"(a3), "r"(a4), "r"(a6), "r"(a7)
+                 : "memory");
+    struct sbiret ret = { (long)a0, (long)a1 };
+    return ret;
+}
+
+static inline int sbi_probe_extension(uint64_t ext) {
+    return sbi_ecall(SBI_EXT_BASE, SBI_BASE_PROBE_EXT, ext, 0, 0).value != 0;
+}
+
+// Pre-v0.2 interface: one M-mode round trip per character
+static inline void sbi_console_putchar(int ch) {
+    sbi_ecall(SBI_EXT_LEGACY_PUTCHAR, 0, ch, 0, 0);
+}
+
+// Returns bytes written, or -1; buf is a physical address
+static inline long sbi_debug_console_write(const char *buf, uint64_t len) {
+    struct sbiret ret = sbi_ecall(SBI_EXT_DBCN, SBI_DBCN_WRITE, len, (uint64_t)buf, 0);
+    return ret.error == SBI_SUCCESS ? ret.value : -1;
+}
+
+static inline void sbi_set_timer(uint64_t stime) {
+    sbi_ecall(SBI_EXT_TIME, 0, stime, 0, 0);
+}
+
+// Only returns if the firmware lacks SRST
+static inline void sbi_shutdown(uint64_t reason) {
+    sbi_ecall(SBI_EXT_SRST, SBI_SRST_RESET, SBI_SRST_SHUTDOWN, reason, 0);
+}
+
+#endif
@@ -0,0 +1,396 @@
+#include "shm.h"
+#include "fs.h"
+#include "process.h"
+#include "spinlock.h"
+#include "printk.h"
+#include "boot.h"
+#include <stddef.h>
+
+#define LOG_SUBSYS LOG_MM
+
+/*
+ * Named shared memory in the style of shm_open(3) and mmap(2). There is
+ * no MMU, so a mapping is the object's own pages at their physical
+ * address; every participant sees the same frame at the same pointer and
+ * nothing is ever copied. What mmap adds is ownership: each page carries
+ * a reference count, held once by the object while it has a name or an
+ * open descriptor and once per mapping covering it. A page goes back to
+ * the pool only when the last of those is gone, so a consumer can keep
+ * reading a frame after the producer unlinks and closes it.
+ *
+ * Without paging an object has to be physically contiguous, so the pool
+ * is carved first-fit by runs of free pages. Mappings belong to a thread
+ * group and are not inherited by fork; a child maps the object by name.
+ */
+struct shm_object {
+    char name[SHM_NAME_LEN];
+    uint32_t first;
+    uint32_t npages;
+    uint64_t size;
+    int fds;
+    int linked;
+    int maps_writable;
+    uint32_t seals;
+    uint32_t gen;
+    int in_use;
+};
+
+struct shm_map {
+    int tgid;
+    int obj;
+    uint32_t gen;
+    uint32_t first;
+    uint32_t npages;
+    int writable;
+    int in_use;
+};
+
+static uint8_t shm_pool[SHM_POOL_PAGES][SHM_PAGE_SIZE]
+    __attribute__((aligned(SHM_PAGE_SIZE))) __noinit;
+static uint16_t page_refs[SHM_POOL_PAGES];
+
+static struct shm_object objects[SHM_MAX_OBJECTS];
+static struct shm_map maps[SHM_MAX_MAPS];
+
+// Taken under fs_lock from fs_close, never the other way round
+static spinlock_t shm_lock;
+
+static uint32_t pages_used;
+static uint64_t maps_total;
+
+void shm_init(void) {
+    spin_init(&shm_lock, "shm");
+    for (int i = 0; i < SHM_POOL_PAGES; i++) {
+        page_refs[i] = 0;
+    }
+    for (int i = 0; i < SHM_MAX_OBJECTS; i++) {
+        objects[i].in_use = 0;
+    }
+    for (int i = 0; i < SHM_MAX_MAPS; i++) {
+        maps[i].in_use = 0;
+    }
+    pages_used = 0;
+    maps_total = 0;
+}
+
+static int name_eq(const char *a, const char *b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+static uint32_t pages_for(uint64_t bytes) {
+    return (bytes + SHM_PAGE_SIZE - 1) / SHM_PAGE_SIZE;
+}
+
+static int pool_alloc(uint32_t npages) {
+    uint32_t run = 0;
+    for (uint32_t i = 0; i < SHM_POOL_PAGES; i++) {
+        run = page_refs[i] ? 0 : run + 1;
+        if (run == npages) {
+            uint32_t first = i + 1 - npages;
+            for (uint32_t p = first; p <= i; p++) {
+                page_refs[p] = 1;
+                uint64_t *w = (uint64_t *)shm_pool[p];
+                for (uint32_t j = 0; j < SHM_PAGE_SIZE / sizeof(uint64_t); j++) {
+                    w[j] = 0;
+                }
+            }
+            pages_used += npages;
+            return first;
+        }
+    }
+    return -1;
+}
+
+static void pages_get(uint32_t first, uint32_t npages) {
+    for (uint32_t p = first; p < first + npages; p++) {
+        page_refs[p]++;
+    }
+}
+
+static void pages_put(uint32_t first, uint32_t npages) {
+    for (uint32_t p = first; p < first + npages; p++) {
+        if (--page_refs[p] == 0) {
+            pages_used--;
+        }
+    }
+}
+
+// Drops the object's own page references once nothing can reach it by name or fd
+static void object_put(struct shm_object *o) {
+    if (o->linked || o->fds) return;
+    
+    if (o->npages) {
+        pages_put(o->first, o->npages);
+    }
+    o->in_use = 0;
+}
+
+static struct shm_object *object_lookup(const char *name) {
+    for (int i = 0; i < SHM_MAX_OBJECTS; i++) {
+        if (objects[i].in_use && objects[i].linked && name_eq(objects[i].name, name)) {
+            return &objects[i];
+        }
+    }
+    return NULL;
+}
+
+static struct shm_object *object_create(const char *name) {
+    for (int i = 0; i < SHM_MAX_OBJECTS; i++) {
+        struct shm_object *o = &objects[i];
+        if (o->in_use) continue;
+        
+        int n;
+        for (n = 0; n < SHM_NAME_LEN - 1 && name[n]; n++) {
+            o->name[n] = name[n];
+        }
+        o->name[n] = '\0';
+        o->first = 0;
+        o->npages = 0;
+        o->size = 0;
+        o->fds = 0;
+        o->linked = 1;
+        o->maps_writable = 0;
+        o->seals = 0;
+        o->gen++;
+        o->in_use = 1;
+        return o;
+    }
+    return NULL;
+}
+
+// Like perf's fds, the descriptor names a slot; the caller holds shm_lock
+static struct shm_object *object_from_fd(int fd, int *mode) {
+    if (fd < 0 || fd >= MAX_FDS || !fd_table[fd].in_use || fd_table[fd].type != FD_SHM) {
+        return NULL;
+    }
+    if (mode) {
+        *mode = fd_table[fd].flags & 3;
+    }
+    return &objects[fd_table[fd].file_idx];
+}
+
+static int name_valid(const char *name) {
+    if (!name || !name[0]) return 0;
+    for (int i = 0; i < SHM_NAME_LEN; i++) {
+        if (!name[i]) return 1;
+    }
+    return 0;
+}
+
+int shm_open(const char *name, int flags) {
+    if (!name_valid(name) || (flags & 3) == O_WRONLY) return -1;
+    
+    uint64_t irq = spin_lock_irqsave(&shm_lock);
+    struct shm_object *o = object_lookup(name);
+    if (o && (flags & O_CREAT) && (flags & O_EXCL)) {
+        spin_unlock_irqrestore(&shm_lock, irq);
+        return -1;
+    }
+    if (!o && (flags & O_CREAT)) {
+        o = object_create(name);
+    }
+    if (!o) {
+        spin_unlock_irqrestore(&shm_lock, irq);
+        return -1;
+    }
+    // Pins the object while fs_alloc_fd runs outside the lock
+    o->fds++;
+    int idx = o - objects;
+    spin_unlock_irqrestore(&shm_lock, irq);
+    
+    int fd = fs_alloc_fd(FD_SHM, idx, flags & 3);
+    if (fd < 0) {
+        shm_close(idx);
+    }
+    return fd;
+}
+
+int shm_unlink(const char *name) {
+    if (!name_valid(name)) return -1;
+    
+    uint64_t irq = spin_lock_irqsave(&shm_lock);
+    struct shm_object *o = object_lookup(name);
+    if (o) {
+        o->linked = 0;
+        object_put(o);
+    }
+    spin_unlock_irqrestore(&shm_lock, irq);
+    return o ? 0 : -1;
+}
+
+/*
+ * The first ftruncate fixes the backing pages; later calls may move the
+ * size within them but can't grow past, since a contiguous object
+ * can't be extended in place under existing mappings.
+ */
+static int object_truncate(struct shm_object *o, uint64_t size) {
+    if (size < o->size && (o->seals & F_SEAL_SHRINK)) return -1;
+    if (size > o->size && (o->seals & F_SEAL_GROW)) return -1;
+    
+    if (!o->npages && size) {
+        uint32_t npages = pages_for(size);
+        int first = npages <= SHM_POOL_PAGES ? pool_alloc(npages) : -1;
+        if (first < 0) {
+            pr_debug("shm: no run of %u free pages for %s\n", npages, o->name);
+            return -1;
+        }
+        o->first = first;
+        o->npages = npages;
+    } else if (pages_for(size) > o->npages) {
+        return -1;
+    }
+    o->size = size;
+    return 0;
+}
+
+int shm_truncate(int fd, uint64_t size) {
+    uint64_t irq = spin_lock_irqsave(&shm_lock);
+    int mode;
+    struct shm_object *o = object_from_fd(fd, &mode);
+    int ret = o && mode == O_RDWR ? object_truncate(o, size) : -1;
+    spin_unlock_irqrestore(&shm_lock, irq);
+    return ret;
+}
+
+static uint64_t object_map(struct shm_object *o, int tgid, uint64_t addr, uint64_t len,
+                           int writable, int flags, uint64_t off) {
+    if (len > o->size || off > o->size - len) return MAP_FAILED;
+    if (writable && (o->seals & F_SEAL_WRITE)) return MAP_FAILED;
+    
+    uint64_t base = (uint64_t)shm_pool[o->first] + off;
+    if ((flags & MAP_FIXED) && addr != base) return MAP_FAILED;
+    
+    int m;
+    for (m = 0; m < SHM_MAX_MAPS && maps[m].in_use; m++) {
+    }
+    if (m == SHM_MAX_MAPS) return MAP_FAILED;
+    
+    maps[m].tgid = tgid;
+    maps[m].obj = o - objects;
+    maps[m].gen = o->gen;
+    maps[m].first = o->first + off / SHM_PAGE_SIZE;
+    maps[m].npages = pages_for(len);
+    maps[m].writable = writable;
+    maps[m].in_use = 1;
+    pages_get(maps[m].first, maps[m].npages);
+    o->maps_writable += writable;
+    maps_total++;
+    return base;
+}
+
+/*
+ * The address is fixed by where the object lives, so a hint is ignored
+ * and MAP_FIXED only succeeds if it names that very address.
+ */
+uint64_t shm_mmap(uint64_t addr, uint64_t len, int prot, int flags, int fd, uint64_t off) {
+    process_t *proc = process_current();
+    if (!proc || !len || !(flags & MAP_SHARED) || off % SHM_PAGE_SIZE) return MAP_FAILED;
+    
+    uint64_t irq = spin_lock_irqsave(&shm_lock);
+    int mode;
+    struct shm_object *o = object_from_fd(fd, &mode);
+    int writable = !!(prot & PROT_WRITE);
+    uint64_t ret = MAP_FAILED;
+    if (o && (!writable || mode == O_RDWR)) {
+        ret = object_map(o, proc->tgid, addr, len, writable, flags, off);
+    }
+    spin_unlock_irqrestore(&shm_lock, irq);
+    return ret;
+}
+
+static void map_drop(struct shm_map *m) {
+    struct shm_object *o = &objects[m->obj];
+    if (m->writable && o->in_use && o->gen == m->gen) {
+        o->maps_writable--;
+    }
+    pages_put(m->first, m->npages);
+    m->in_use = 0;
+}
+
+// Only whole mappings, exactly as mmap returned them, can be removed
+int shm_munmap(uint64_t addr, uint64_t len) {
+    process_t *proc = process_current();
+    if (!proc || !len || addr % SHM_PAGE_SIZE) return -1;
+    
+    uint64_t irq = spin_lock_irqsave(&shm_lock);
+    int ret = -1;
+    for (int i = 0; i < SHM_MAX_MAPS; i++) {
+        struct shm_map *m = &maps[i];
+        if (m->in_use && m->tgid == proc->tgid &&
+            (uint64_t)shm_pool[m->first] == addr && m->npages == pages_for(len)) {
+            map_drop(m);
+            ret = 0;
+            break;
+        }
+    }
+    spin_unlock_irqrestore(&shm_lock, irq);
+    return ret;
+}
+
+/*
+ * Seals follow memfd: F_SEAL_WRITE is refused while writable mappings
+ * exist and afterwards stops new ones, which makes a fully built frame
+ * read-only for everyone who maps it later.
+ */
+static int object_add_seals(struct shm_object *o, uint64_t seals) {
+    if (o->seals & F_SEAL_SEAL) return -1;
+    if (seals & ~(uint64_t)(F_SEAL_SEAL | F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE)) return -1;
+    if ((seals & F_SEAL_WRITE) && o->maps_writable) return -1;
+    
+    o->seals |= seals;
+    return 0;
+}
+
+int shm_fcntl(int fd, int cmd, uint64_t arg) {
+    uint64_t irq = spin_lock_irqsave(&shm_lock);
+    int mode;
+    struct shm_object *o = object_from_fd(fd, &mode);
+    int ret = -1;
+    if (o && cmd == F_GET_SEALS) {
+        ret = o->seals;
+    } else if (o && cmd == F_ADD_SEALS && mode == O_RDWR) {
+        ret = object_add_seals(o, arg);
+    }
+    spin_unlock_irqrestore(&shm_lock, irq);
+    return ret;
+}
+
+// From fs_close, under fs_lock
+void shm_close(int idx) {
+    uint64_t irq = spin_lock_irqsave(&shm_lock);
+    struct shm_object *o = &objects[idx];
+    if (o->in_use && o->fds > 0) {
+        o->fds--;
+        object_put(o);
+    }
+    spin_unlock_irqrestore(&shm_lock, irq);
+}
+
+// Mappings die with the thread group, like an address space would
+void shm_release_process(int tgid) {
+    uint64_t irq = spin_lock_irqsave(&shm_lock);
+    for (int i = 0; i < SHM_MAX_MAPS; i++) {
+        if (maps[i].in_use && maps[i].tgid == tgid) {
+            map_drop(&maps[i]);
+        }
+    }
+    spin_unlock_irqrestore(&shm_lock, irq);
+}
+
+void shm_dump_stats(void) {
+    if (!maps_total && !pages_used) return;
+    
+    int objs = 0, mapped = 0;
+    for (int i = 0; i < SHM_MAX_OBJECTS; i++) {
+        objs += objects[i].in_use;
+    }
+    for (int i = 0; i < SHM_MAX_MAPS; i++) {
+        mapped += maps[i].in_use;
+    }
+    printk("shm: %d objects, %d mappings (%lu total), %u/%u pages in use\n",
+           objs, mapped, maps_total, pages_used, SHM_POOL_PAGES);
+}
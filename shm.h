@@ -0,0 +1,40 @@
+#ifndef SHM_H
+#define SHM_H
+
+#include <stdint.h>
+
+#define SHM_PAGE_SIZE   4096
+#define SHM_POOL_PAGES  2048
+#define SHM_MAX_OBJECTS 16
+#define SHM_MAX_MAPS    64
+#define SHM_NAME_LEN    32
+
+#define PROT_READ  0x1
+#define PROT_WRITE 0x2
+
+#define MAP_SHARED 0x01
+#define MAP_FIXED  0x10
+
+#define MAP_FAILED ((uint64_t)-1)
+
+// fcntl() commands and seals, numbered as on Linux
+#define F_ADD_SEALS 1033
+#define F_GET_SEALS 1034
+
+#define F_SEAL_SEAL   0x1
+#define F_SEAL_SHRINK 0x2
+#define F_SEAL_GROW   0x4
+#define F_SEAL_WRITE  0x8
+
+void shm_init(void);
+int shm_open(const char *name, int flags);
+int shm_unlink(const char *name);
+int shm_truncate(int fd, uint64_t size);
+uint64_t shm_mmap(uint64_t addr, uint64_t len, int prot, int flags, int fd, uint64_t off);
+int shm_munmap(uint64_t addr, uint64_t len);
+int shm_fcntl(int fd, int cmd, uint64_t arg);
+void shm_close(int idx);
+void shm_release_process(int tgid);
+void shm_dump_stats(void);
+
+#endif
@@ -0,0 +1,190 @@
+#include "signal.h"
+#include "process.h"
+#include "printk.h"
+#include "riscv.h"
+#include <stddef.h>
+
+extern void signal_trampoline(void);
+
+static const uint64_t sig_unblockable = SIGMASK(SIGKILL);
+static const uint64_t sig_default_ignore = SIGMASK(SIGCHLD);
+
+static uint64_t deliveries;
+static uint64_t delivery_cycles;
+
+static int sig_valid(int sig) {
+    return sig > 0 && sig < NSIG;
+}
+
+static uint64_t sig_deliverable(process_t *proc) {
+    return proc->sig_pending & ~(proc->sig_blocked & ~sig_unblockable);
+}
+
+int signal_send(process_t *proc, int sig) {
+    if (!sig_valid(sig)) return -1;
+    if (proc->state == PROC_ZOMBIE) return 0;
+    
+    // Ignored signals are discarded at generation
+    uint64_t handler = proc->sigactions[sig].sa_handler;
+    if (sig != SIGKILL && (handler == SIG_IGN ||
+        (handler == SIG_DFL && (sig_default_ignore & SIGMASK(sig))))) {
+        return 0;
+    }
+    
+    proc->sig_pending |= SIGMASK(sig);
+    
+    // Pull the target out of any interruptible wait so delivery happens
+    // on its way back to user mode
+    if (sig_deliverable(proc) & SIGMASK(sig)) {
+        process_interrupt(proc);
+    }
+    return 0;
+}
+
+/*
+ * For faults: retrying the faulting instruction with the signal ignored
+ * or blocked would trap again forever, so like Linux's force_sig the
+ * handler falls back to SIG_DFL and the signal is unblocked first.
+ */
+int signal_force(process_t *proc, int sig) {
+    if (!sig_valid(sig)) return -1;
+    
+    struct sigaction *act = &proc->sigactions[sig];
+    if (act->sa_handler == SIG_IGN || (proc->sig_blocked & SIGMASK(sig))) {
+        act->sa_handler = SIG_DFL;
+        proc->sig_blocked &= ~SIGMASK(sig);
+    }
+    return signal_send(proc, sig);
+}
+
+int signal_action(int sig, const struct sigaction *act, struct sigaction *old) {
+    process_t *proc = process_current();
+    if (!proc || !sig_valid(sig)) return -1;
+    
+    if (old) {
+        *old = proc->sigactions[sig];
+    }
+    if (act) {
+        if (sig == SIGKILL) return -1;
+        proc->sigactions[sig] = *act;
+        if (act->sa_handler == SIG_IGN) {
+            proc->sig_pending &= ~SIGMASK(sig);
+        }
+    }
+    return 0;
+}
+
+int signal_procmask(int how, const uint64_t *set, uint64_t *old) {
+    process_t *proc = process_current();
+    if (!proc) return -1;
+    
+    if (old) {
+        *old = proc->sig_blocked;
+    }
+    if (!set) return 0;
+    
+    switch (how) {
+        case SIG_BLOCK:
+            proc->sig_blocked |= *set;
+            break;
+        case SIG_UNBLOCK:
+            proc->sig_blocked &= ~*set;
+            break;
+        case SIG_SETMASK:
+            proc->sig_blocked = *set;
+            break;
+        default:
+            return -1;
+    }
+    proc->sig_blocked &= ~sig_unblockable;
+    return 0;
+}
+
+/*
+ * The frame restore has to wait until trap.S has saved s0-s11, or the
+ * full-restore path would put the live values back over the saved ones;
+ * signal_handle applies it from process_switch_frame.
+ */
+int signal_return(void) {
+    process_t *proc = process_current();
+    if (!proc) return -1;
+    
+    proc->sigreturn_pending = 1;
+    return 0;
+}
+
+int signal_work_pending(process_t *proc) {
+    return proc->sigreturn_pending || sig_deliverable(proc) != 0;
+}
+
+static void signal_restore(process_t *proc, struct trap_frame *tf) {
+    const struct sigframe *frame = (const struct sigframe *)tf->x2;
+    uint64_t *gpr = &tf->x1;
+    const uint64_t *saved = &frame->tf.x1;
+    
+    for (int i = 0; i < 31; i++) {
+        gpr[i] = saved[i];
+    }
+    // Only the pc comes back from user memory; sstatus stays the kernel's
+    tf->sepc = frame->tf.sepc;
+    proc->sig_blocked = frame->mask & ~sig_unblockable;
+}
+
+static void signal_setup_frame(process_t *proc, int sig, struct trap_frame *tf) {
+    const struct sigaction *act = &proc->sigactions[sig];
+    uint64_t sp = (tf->x2 - sizeof(struct sigframe)) & ~15ULL;
+    struct sigframe *frame = (struct sigframe *)sp;
+    
+    frame->tf = *tf;
+    frame->mask = proc->sig_blocked;
+    
+    proc->sig_blocked |= act->sa_mask;
+    if (!(act->sa_flags & SA_NODEFER)) {
+        proc->sig_blocked |= SIGMASK(sig);
+    }
+    proc->sig_blocked &= ~sig_unblockable;
+    
+    tf->x2 = sp;
+    tf->x10 = sig;
+    tf->x1 = act->sa_restorer ? act->sa_restorer : (uint64_t)signal_trampoline;
+    tf->sepc = act->sa_handler;
+}
+
+// Runs with tf holding proc's full user context
+void signal_handle(process_t *proc, struct trap_frame *tf) {
+    if (tf->sstatus & SSTATUS_SPP) return;
+    
+    uint64_t start = read_cycle();
+    
+    if (proc->sigreturn_pending) {
+        proc->sigreturn_pending = 0;
+        signal_restore(proc, tf);
+    }
+    
+    uint64_t ready;
+    while ((ready = sig_deliverable(proc)) != 0) {
+        int sig = 0;
+        while (!(ready & SIGMASK(sig))) sig++;
+        proc->sig_pending &= ~SIGMASK(sig);
+        
+        uint64_t handler = proc->sigactions[sig].sa_handler;
+        if (sig == SIGKILL || handler == SIG_DFL) {
+            if (sig != SIGKILL && (sig_default_ignore & SIGMASK(sig))) continue;
+            process_terminate_group(proc, 128 + sig);
+            return;
+        }
+        if (handler == SIG_IGN) continue;
+        
+        signal_setup_frame(proc, sig, tf);
+        deliveries++;
+        delivery_cycles += read_cycle() - start;
+        return;
+    }
+}
+
+void signal_dump_stats(void) {
+    if (deliveries) {
+        printk("Signals: %lu delivered, avg %lu cycles to set up\n",
+               deliveries, delivery_cycles / deliveries);
+    }
+}
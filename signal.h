@@ -0,0 +1,62 @@
+#ifndef SIGNAL_H
+#define SIGNAL_H
+
+#include <stdint.h>
+#include "trap.h"
+
+#define NSIG 32
+
+#define SIGHUP  1
+#define SIGINT  2
+#define SIGQUIT 3
+#define SIGILL  4
+#define SIGTRAP 5
+#define SIGABRT 6
+#define SIGBUS  7
+#define SIGFPE  8
+#define SIGKILL 9
+#define SIGUSR1 10
+#define SIGSEGV 11
+#define SIGUSR2 12
+#define SIGPIPE 13
+#define SIGALRM 14
+#define SIGTERM 15
+#define SIGCHLD 17
+
+#define SIG_DFL 0
+#define SIG_IGN 1
+
+#define SA_NODEFER 0x40000000
+
+#define SIG_BLOCK   0
+#define SIG_UNBLOCK 1
+#define SIG_SETMASK 2
+
+#define SIGMASK(sig) (1ULL << (sig))
+
+struct process;
+
+// sa_restorer of 0 returns through the kernel's signal_trampoline
+struct sigaction {
+    uint64_t sa_handler;
+    uint64_t sa_mask;
+    uint64_t sa_flags;
+    uint64_t sa_restorer;
+};
+
+// Pushed on the user stack for the duration of a handler
+struct sigframe {
+    struct trap_frame tf;
+    uint64_t mask;
+};
+
+int signal_send(struct process *proc, int sig);
+int signal_force(struct process *proc, int sig);
+int signal_action(int sig, const struct sigaction *act, struct sigaction *old);
+int signal_procmask(int how, const uint64_t *set, uint64_t *old);
+int signal_return(void);
+int signal_work_pending(struct process *proc);
+void signal_handle(struct process *proc, struct trap_frame *tf);
+void signal_dump_stats(void);
+
+#endif
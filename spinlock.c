@@ -0,0 +1,128 @@
+#include "spinlock.h"
+#include "printk.h"
+#include <stddef.h>
+
+#ifdef CONFIG_LOCK_STATS
+static spinlock_t *spin_registry;
+static rwlock_t *rw_registry;
+
+static void stats_wait(struct lock_stats *st, uint64_t start) {
+    uint64_t waited = read_cycle() - start;
+    st->contended++;
+    st->wait_cycles += waited;
+    if (waited > st->max_wait) st->max_wait = waited;
+}
+#endif
+
+void spin_init(spinlock_t *lock, const char *name) {
+    lock->next = 0;
+    lock->owner = 0;
+    lock->name = name;
+#ifdef CONFIG_LOCK_STATS
+    lock->stats = (struct lock_stats){0};
+    lock->stats_next = spin_registry;
+    spin_registry = lock;
+#endif
+}
+
+void spin_lock_slow(spinlock_t *lock, uint32_t ticket) {
+#ifdef CONFIG_LOCK_STATS
+    uint64_t start = read_cycle();
+#endif
+    while (__atomic_load_n(&lock->owner, __ATOMIC_ACQUIRE) != ticket) {
+        asm volatile("nop");
+    }
+    LOCK_STAT(stats_wait(&lock->stats, start));
+}
+
+void rwlock_init(rwlock_t *lock, const char *name) {
+    lock->state = 0;
+    lock->writers_waiting = 0;
+    lock->name = name;
+#ifdef CONFIG_LOCK_STATS
+    lock->stats = (struct lock_stats){0};
+    lock->stats_next = rw_registry;
+    rw_registry = lock;
+#endif
+}
+
+void read_lock(rwlock_t *lock) {
+#ifdef CONFIG_LOCK_STATS
+    uint64_t start = 0;
+#endif
+    for (;;) {
+        uint32_t s = __atomic_load_n(&lock->state, __ATOMIC_RELAXED);
+        if (!(s & (RW_WRITER | RW_PENDING)) &&
+            __atomic_compare_exchange_n(&lock->state, &s, s + 1, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            break;
+        }
+        LOCK_STAT(if (!start) start = read_cycle());
+    }
+    // Readers overlap, so only the counters that tolerate races are kept
+    LOCK_STAT(__atomic_fetch_add(&lock->stats.acquisitions, 1, __ATOMIC_RELAXED));
+    LOCK_STAT(if (start) __atomic_fetch_add(&lock->stats.contended, 1, __ATOMIC_RELAXED));
+}
+
+void read_unlock(rwlock_t *lock) {
+    __atomic_fetch_sub(&lock->state, 1, __ATOMIC_RELEASE);
+}
+
+void write_lock(rwlock_t *lock) {
+#ifdef CONFIG_LOCK_STATS
+    uint64_t start = 0;
+#endif
+    int queued = 0;
+    for (;;) {
+        uint32_t s = __atomic_load_n(&lock->state, __ATOMIC_RELAXED);
+        if (!(s & (RW_WRITER | RW_READERS))) {
+            // RW_PENDING stays set for the writers still queued behind us
+            if (__atomic_compare_exchange_n(&lock->state, &s, RW_WRITER | (s & RW_PENDING), 0,
+                                            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else {
+            if (!queued) {
+                __atomic_fetch_add(&lock->writers_waiting, 1, __ATOMIC_RELAXED);
+                queued = 1;
+            }
+            // Re-armed each pass: the last writer out may have just cleared it
+            if (!(s & RW_PENDING)) {
+                __atomic_fetch_or(&lock->state, RW_PENDING, __ATOMIC_RELAXED);
+            }
+        }
+        LOCK_STAT(if (!start) start = read_cycle());
+    }
+    if (queued && __atomic_sub_fetch(&lock->writers_waiting, 1, __ATOMIC_RELAXED) == 0) {
+        __atomic_fetch_and(&lock->state, ~RW_PENDING, __ATOMIC_RELAXED);
+    }
+    LOCK_STAT(lock->stats.acquisitions++);
+    LOCK_STAT(if (start) stats_wait(&lock->stats, start));
+}
+
+void write_unlock(rwlock_t *lock) {
+    __atomic_fetch_and(&lock->state, ~RW_WRITER, __ATOMIC_RELEASE);
+}
+
+#ifdef CONFIG_LOCK_STATS
+static void lock_print(const char *name, const struct lock_stats *st) {
+    if (!st->acquisitions) return;
+    printk("  %s: %lu acquisitions, %lu contended", name, st->acquisitions, st->contended);
+    if (st->contended) {
+        printk(", avg wait %lu cycles, max %lu", st->wait_cycles / st->contended, st->max_wait);
+    }
+    printk("\n");
+}
+#endif
+
+void lock_dump_stats(void) {
+#ifdef CONFIG_LOCK_STATS
+    printk("Lock statistics:\n");
+    for (spinlock_t *l = spin_registry; l; l = l->stats_next) {
+        lock_print(l->name, &l->stats);
+    }
+    for (rwlock_t *l = rw_registry; l; l = l->stats_next) {
+        lock_print(l->name, &l->stats);
+    }
+#endif
+}
@@ -0,0 +1,112 @@
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include <stdint.h>
+#include "riscv.h"
+
+/*
+ * Per-lock counters, compiled in with the LOCK_STATS CMake option. The
+ * holder updates them, so they need no atomics of their own.
+ */
+struct lock_stats {
+    uint64_t acquisitions;
+    uint64_t contended;
+    uint64_t wait_cycles;
+    uint64_t max_wait;
+};
+
+#ifdef CONFIG_LOCK_STATS
+#define LOCK_STAT(stmt) do { stmt; } while (0)
+#else
+#define LOCK_STAT(stmt) do { } while (0)
+#endif
+
+/*
+ * Ticket lock: amoadd on next hands out tickets, the holder bumps owner
+ * on release, so waiters are served in arrival order.
+ */
+typedef struct spinlock {
+    uint32_t next;
+    uint32_t owner;
+    const char *name;
+#ifdef CONFIG_LOCK_STATS
+    struct lock_stats stats;
+    struct spinlock *stats_next;
+#endif
+} spinlock_t;
+
+#define RW_WRITER  0x80000000U
+#define RW_PENDING 0x40000000U
+#define RW_READERS 0x3fffffffU
+
+// Readers share; RW_PENDING holds off new readers while any writer waits
+typedef struct rwlock {
+    uint32_t state;
+    uint32_t writers_waiting;
+    const char *name;
+#ifdef CONFIG_LOCK_STATS
+    struct lock_stats stats;
+    struct rwlock *stats_next;
+#endif
+} rwlock_t;
+
+void spin_init(spinlock_t *lock, const char *name);
+void spin_lock_slow(spinlock_t *lock, uint32_t ticket);
+void rwlock_init(rwlock_t *lock, const char *name);
+void read_lock(rwlock_t *lock);
+void read_unlock(rwlock_t *lock);
+void write_lock(rwlock_t *lock);
+void write_unlock(rwlock_t *lock);
+void lock_dump_stats(void);
+
+static inline uint32_t amoadd_w_aq(uint32_t *p, uint32_t v) {
+#ifdef __riscv
+    uint32_t old;
+    asm volatile("amoadd.w.aq %0, %2, (%1)" : "=r"(old) : "r"(p), "r"(v) : "memory");
+    return old;
+#else
+    return __atomic_fetch_add(p, v, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static inline void spin_lock(spinlock_t *lock) {
+    uint32_t ticket = amoadd_w_aq(&lock->next, 1);
+    if (__atomic_load_n(&lock->owner, __ATOMIC_ACQUIRE) != ticket) {
+        spin_lock_slow(lock, ticket);
+    }
+    LOCK_STAT(lock->stats.acquisitions++);
+}
+
+// Takes the lock only if nobody holds or waits for it
+static inline int spin_trylock(spinlock_t *lock) {
+    uint32_t owner = __atomic_load_n(&lock->owner, __ATOMIC_ACQUIRE);
+    if (!__atomic_compare_exchange_n(&lock->next, &owner, owner + 1, 0,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return 0;
+    }
+    LOCK_STAT(lock->stats.acquisitions++);
+    return 1;
+}
+
+static inline void spin_unlock(spinlock_t *lock) {
+    __atomic_store_n(&lock->owner, lock->owner + 1, __ATOMIC_RELEASE);
+}
+
+static inline int spin_is_locked(spinlock_t *lock) {
+    return __atomic_load_n(&lock->owner, __ATOMIC_RELAXED) !=
+           __atomic_load_n(&lock->next, __ATOMIC_RELAXED);
+}
+
+// For state an interrupt handler on this hart may also take the lock for
+static inline uint64_t spin_lock_irqsave(spinlock_t *lock) {
+    uint64_t flags = irq_save();
+    spin_lock(lock);
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t *lock, uint64_t flags) {
+    spin_unlock(lock);
+    irq_restore(flags);
+}
+
+#endif
@@ -2,97 +2,497 @@
 #include "printk.h"
 #include "process.h"
 #include "fs.h"
+#include "riscv.h"
+#include "ring.h"
+#include "futex.h"
+#include "timer.h"
+#include "epoll.h"
+#include "signal.h"
+#include "uart.h"
+#include "spinlock.h"
+#include "hart.h"
+#include "profile.h"
+#include "perf.h"
+#include "trace.h"
+#include "workqueue.h"
+#include "shm.h"
+#include "tick.h"
+#include <stddef.h>
 
-#define SYS_EXIT    1
-#define SYS_FORK    2
-#define SYS_READ    3
-#define SYS_WRITE   4
-#define SYS_OPEN    5
-#define SYS_CLOSE   6
-#define SYS_WAIT    7
-#define SYS_EXEC    8
-#define SYS_GETPID  9
-#define SYS_KILL    10
-#define SYS_PUTCHAR 100
-
-void syscall_handler(struct trap_frame *tf) {
+#define LOG_SUBSYS LOG_SYSCALL
+
+typedef uint64_t (*syscall_fn_t)(uint64_t a0, uint64_t a1, uint64_t a2,
+                                 uint64_t a3, uint64_t a4, uint64_t a5);
+
+// Syscalls that never switch process may be queued on an io_ring, as long
+// as they fit the three arguments an sqe carries. One that blocks must
+// wake with process_wake_restart, which ring_enter resumes from.
+#define SYSCALL_F_BATCH 0x1
+
+typedef struct {
+    const char *name;
+    int nargs;
+    int flags;
+    syscall_fn_t fn;
+} syscall_desc_t;
+
+static struct syscall_stats syscall_stats[NR_SYSCALLS];
+static uint64_t unknown_syscalls;
+
+static uint64_t sys_exit(uint64_t code, uint64_t a1, uint64_t a2,
+                         uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    process_exit((int)code);
+    return 0;
+}
+
+static uint64_t sys_exit_group(uint64_t code, uint64_t a1, uint64_t a2,
+                               uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    process_exit_group((int)code);
+    return 0;
+}
+
+static uint64_t sys_clone(uint64_t flags, uint64_t fn, uint64_t stack,
+                          uint64_t arg, uint64_t tls, uint64_t ctid) {
+    return process_clone(flags, (void (*)(void *))fn, (void *)stack, (void *)arg,
+                         (void *)tls, (uint32_t *)ctid);
+}
+
+static uint64_t sys_fork(uint64_t a0, uint64_t a1, uint64_t a2,
+                         uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a0; (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    int pid = process_fork();
+    if (pid > 0) {
+        process_t *child = process_get(pid);
+        if (child) {
+            child->context.regs[10] = 0;
+        }
+    }
+    return pid;
+}
+
+static uint64_t sys_read(uint64_t fd, uint64_t buf, uint64_t count,
+                         uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a3; (void)a4; (void)a5;
+    return fs_read((int)fd, (void *)buf, (uint32_t)count);
+}
+
+static uint64_t sys_write(uint64_t fd, uint64_t buf, uint64_t count,
+                          uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a3; (void)a4; (void)a5;
+    return fs_write((int)fd, (const void *)buf, (uint32_t)count);
+}
+
+static uint64_t sys_open(uint64_t path, uint64_t flags, uint64_t a2,
+                         uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    return fs_open((const char *)path, (int)flags);
+}
+
+static uint64_t sys_close(uint64_t fd, uint64_t a1, uint64_t a2,
+                          uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    return fs_close((int)fd);
+}
+
+static uint64_t sys_wait(uint64_t status, uint64_t a1, uint64_t a2,
+                         uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    return process_wait((int *)status);
+}
+
+static uint64_t sys_exec(uint64_t path, uint64_t a1, uint64_t a2,
+                         uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    return process_exec((const char *)path);
+}
+
+static uint64_t sys_getpid(uint64_t a0, uint64_t a1, uint64_t a2,
+                           uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a0; (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    process_t *proc = process_current();
+    return proc ? proc->tgid : -1;
+}
+
+static uint64_t sys_gettid(uint64_t a0, uint64_t a1, uint64_t a2,
+                           uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a0; (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    process_t *proc = process_current();
+    return proc ? proc->pid : -1;
+}
+
+static uint64_t sys_kill(uint64_t pid, uint64_t sig, uint64_t a2,
+                         uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    return process_kill((int)pid, (int)sig);
+}
+
+static uint64_t sys_sysstat(uint64_t num, uint64_t out, uint64_t a2,
+                            uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    if (!out) {
+        syscall_dump_stats();
+        trap_dump_irq_stats();
+        signal_dump_stats();
+        printk_dump_stats();
+        uart_dump_stats();
+        lock_dump_stats();
+        hart_dump_stats();
+        profile_dump_stats();
+        perf_dump_stats();
+        trace_dump_stats();
+        workqueue_dump_stats();
+        shm_dump_stats();
+        timer_dump_stats();
+        tick_dump_stats();
+        process_dump_sched_stats();
+        return 0;
+    }
+    return syscall_get_stats((int)num, (struct syscall_stats *)out);
+}
+
+static uint64_t sys_ring_setup(uint64_t ring, uint64_t a1, uint64_t a2,
+                               uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    return ring_setup((struct io_ring *)ring);
+}
+
+static uint64_t sys_ring_enter(uint64_t to_submit, uint64_t a1, uint64_t a2,
+                               uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    return ring_enter((uint32_t)to_submit);
+}
+
+static uint64_t sys_futex(uint64_t uaddr, uint64_t op, uint64_t val,
+                          uint64_t timeout, uint64_t a4, uint64_t a5) {
+    (void)a4; (void)a5;
+    switch (op) {
+        case FUTEX_WAIT: {
+            uint64_t deadline = 0;
+            if (timeout) {
+                deadline = read_time() + timespec_to_ticks((const struct timespec *)timeout);
+            }
+            return futex_wait((uint32_t *)uaddr, (uint32_t)val, deadline);
+        }
+        case FUTEX_WAKE:
+            return futex_wake((uint32_t *)uaddr, (int)val);
+        default:
+            return -1;
+    }
+}
+
+static uint64_t sys_nanosleep(uint64_t req, uint64_t a1, uint64_t a2,
+                              uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    if (!req) return -1;
+    return process_sleep(read_time() + timespec_to_ticks((const struct timespec *)req));
+}
+
+static uint64_t sys_clock_gettime(uint64_t clk, uint64_t ts, uint64_t a2,
+                                  uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    if (!ts) return -1;
+    return timer_clock_gettime((int)clk, (struct timespec *)ts);
+}
+
+static uint64_t sys_epoll_create(uint64_t a0, uint64_t a1, uint64_t a2,
+                                 uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a0; (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    return epoll_create();
+}
+
+static uint64_t sys_epoll_ctl(uint64_t epfd, uint64_t op, uint64_t fd,
+                              uint64_t event, uint64_t a4, uint64_t a5) {
+    (void)a4; (void)a5;
+    return epoll_ctl((int)epfd, (int)op, (int)fd, (const struct epoll_event *)event);
+}
+
+static uint64_t sys_epoll_wait(uint64_t epfd, uint64_t events, uint64_t maxevents,
+                               uint64_t timeout_ms, uint64_t a4, uint64_t a5) {
+    (void)a4; (void)a5;
+    return epoll_wait((int)epfd, (struct epoll_event *)events, (int)maxevents, (int)timeout_ms);
+}
+
+static uint64_t sys_sigaction(uint64_t sig, uint64_t act, uint64_t oldact,
+                              uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a3; (void)a4; (void)a5;
+    return signal_action((int)sig, (const struct sigaction *)act, (struct sigaction *)oldact);
+}
+
+static uint64_t sys_sigprocmask(uint64_t how, uint64_t set, uint64_t oldset,
+                                uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a3; (void)a4; (void)a5;
+    return signal_procmask((int)how, (const uint64_t *)set, (uint64_t *)oldset);
+}
+
+static uint64_t sys_sigreturn(uint64_t a0, uint64_t a1, uint64_t a2,
+                              uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a0; (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    return signal_return();
+}
+
+static uint64_t sys_loglevel(uint64_t subsys, uint64_t level, uint64_t a2,
+                             uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    return log_set_level((int)subsys, (int)level);
+}
+
+static uint64_t sys_profile(uint64_t cmd, uint64_t arg, uint64_t buf,
+                            uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a3; (void)a4; (void)a5;
+    return profile_ctl((int)cmd, arg, (void *)buf);
+}
+
+static uint64_t sys_perf_open(uint64_t attr, uint64_t pid, uint64_t a2,
+                              uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    return perf_event_create((const struct perf_event_attr *)attr, (int)pid);
+}
+
+static uint64_t sys_perf_ctl(uint64_t fd, uint64_t cmd, uint64_t a2,
+                             uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    return perf_event_ctl((int)fd, (int)cmd);
+}
+
+static uint64_t sys_trace(uint64_t cmd, uint64_t arg, uint64_t buf,
+                          uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a3; (void)a4; (void)a5;
+    return trace_ctl((int)cmd, arg, (void *)buf);
+}
+
+static uint64_t sys_shm_open(uint64_t name, uint64_t flags, uint64_t a2,
+                             uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    return shm_open((const char *)name, (int)flags);
+}
+
+static uint64_t sys_shm_unlink(uint64_t name, uint64_t a1, uint64_t a2,
+                               uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    return shm_unlink((const char *)name);
+}
+
+static uint64_t sys_ftruncate(uint64_t fd, uint64_t size, uint64_t a2,
+                              uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    return shm_truncate((int)fd, size);
+}
+
+static uint64_t sys_mmap(uint64_t addr, uint64_t len, uint64_t prot,
+                         uint64_t flags, uint64_t fd, uint64_t off) {
+    return shm_mmap(addr, len, (int)prot, (int)flags, (int)fd, off);
+}
+
+static uint64_t sys_munmap(uint64_t addr, uint64_t len, uint64_t a2,
+                           uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    return shm_munmap(addr, len);
+}
+
+static uint64_t sys_fcntl(uint64_t fd, uint64_t cmd, uint64_t arg,
+                          uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a3; (void)a4; (void)a5;
+    return shm_fcntl((int)fd, (int)cmd, arg);
+}
+
+// Timer slack is per thread; 0 puts back the boot-time default
+static uint64_t sys_prctl(uint64_t option, uint64_t arg, uint64_t a2,
+                          uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    process_t *proc = process_current();
+    if (!proc) return -1;
+    
+    switch (option) {
+        case PR_SET_TIMERSLACK:
+            proc->timer_slack = timer_ns_to_ticks(arg ? arg : CONFIG_TIMER_SLACK_NS);
+            return 0;
+        case PR_GET_TIMERSLACK:
+            return timer_ticks_to_ns(proc->timer_slack);
+        default:
+            return -1;
+    }
+}
+
+// As on Linux, no flags are defined yet and any set is refused
+static uint64_t sys_sched_setattr(uint64_t pid, uint64_t attr, uint64_t flags,
+                                  uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a3; (void)a4; (void)a5;
+    if (flags) return -1;
+    return process_sched_setattr((int)pid, (const struct sched_attr *)attr);
+}
+
+static uint64_t sys_sched_getattr(uint64_t pid, uint64_t attr, uint64_t size,
+                                  uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a3; (void)a4; (void)a5;
+    if (size < sizeof(struct sched_attr)) return -1;
+    return process_sched_getattr((int)pid, (struct sched_attr *)attr);
+}
+
+static uint64_t sys_sched_yield(uint64_t a0, uint64_t a1, uint64_t a2,
+                                uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a0; (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    process_sched_yield();
+    return 0;
+}
+
+static uint64_t sys_putchar(uint64_t c, uint64_t a1, uint64_t a2,
+                            uint64_t a3, uint64_t a4, uint64_t a5) {
+    (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    printk("%c", (char)c);
+    return 0;
+}
+
+static const syscall_desc_t syscall_table[NR_SYSCALLS] = {
+    [SYS_EXIT]          = { "exit",          1, 0,               sys_exit },
+    [SYS_FORK]          = { "fork",          0, 0,               sys_fork },
+    [SYS_READ]          = { "read",          3, SYSCALL_F_BATCH, sys_read },
+    [SYS_WRITE]         = { "write",         3, SYSCALL_F_BATCH, sys_write },
+    [SYS_OPEN]          = { "open",          2, SYSCALL_F_BATCH, sys_open },
+    [SYS_CLOSE]         = { "close",         1, SYSCALL_F_BATCH, sys_close },
+    [SYS_WAIT]          = { "wait",          1, 0,               sys_wait },
+    [SYS_EXEC]          = { "exec",          1, 0,               sys_exec },
+    [SYS_GETPID]        = { "getpid",        0, SYSCALL_F_BATCH, sys_getpid },
+    [SYS_KILL]          = { "kill",          2, SYSCALL_F_BATCH, sys_kill },
+    [SYS_SYSSTAT]       = { "sysstat",       2, 0,               sys_sysstat },
+    [SYS_RING_SETUP]    = { "ring_setup",    1, 0,               sys_ring_setup },
+    [SYS_RING_ENTER]    = { "ring_enter",    1, 0,               sys_ring_enter },
+    [SYS_FUTEX]         = { "futex",         4, 0,               sys_futex },
+    [SYS_NANOSLEEP]     = { "nanosleep",     1, 0,               sys_nanosleep },
+    [SYS_CLOCK_GETTIME] = { "clock_gettime", 2, SYSCALL_F_BATCH, sys_clock_gettime },
+    [SYS_EPOLL_CREATE]  = { "epoll_create",  0, 0,               sys_epoll_create },
+    [SYS_EPOLL_CTL]     = { "epoll_ctl",     4, 0,               sys_epoll_ctl },
+    [SYS_EPOLL_WAIT]    = { "epoll_wait",    4, 0,               sys_epoll_wait },
+    [SYS_SIGACTION]     = { "sigaction",     3, 0,               sys_sigaction },
+    [SYS_SIGPROCMASK]   = { "sigprocmask",   3, 0,               sys_sigprocmask },
+    [SYS_SIGRETURN]     = { "sigreturn",     0, 0,               sys_sigreturn },
+    [SYS_LOGLEVEL]      = { "loglevel",      2, SYSCALL_F_BATCH, sys_loglevel },
+    [SYS_PROFILE]       = { "profile",       3, 0,               sys_profile },
+    [SYS_PERF_OPEN]     = { "perf_open",     2, 0,               sys_perf_open },
+    [SYS_PERF_CTL]      = { "perf_ctl",      2, SYSCALL_F_BATCH, sys_perf_ctl },
+    [SYS_TRACE]         = { "trace",         3, 0,               sys_trace },
+    [SYS_CLONE]         = { "clone",         6, 0,               sys_clone },
+    [SYS_GETTID]        = { "gettid",        0, SYSCALL_F_BATCH, sys_gettid },
+    [SYS_EXIT_GROUP]    = { "exit_group",    1, 0,               sys_exit_group },
+    [SYS_SHM_OPEN]      = { "shm_open",      2, SYSCALL_F_BATCH, sys_shm_open },
+    [SYS_SHM_UNLINK]    = { "shm_unlink",    1, SYSCALL_F_BATCH, sys_shm_unlink },
+    [SYS_FTRUNCATE]     = { "ftruncate",     2, SYSCALL_F_BATCH, sys_ftruncate },
+    [SYS_MMAP]          = { "mmap",          6, 0,               sys_mmap },
+    [SYS_MUNMAP]        = { "munmap",        2, SYSCALL_F_BATCH, sys_munmap },
+    [SYS_FCNTL]         = { "fcntl",         3, SYSCALL_F_BATCH, sys_fcntl },
+    [SYS_PRCTL]         = { "prctl",         2, SYSCALL_F_BATCH, sys_prctl },
+    [SYS_SCHED_SETATTR] = { "sched_setattr", 3, 0,               sys_sched_setattr },
+    [SYS_SCHED_GETATTR] = { "sched_getattr", 3, SYSCALL_F_BATCH, sys_sched_getattr },
+    [SYS_SCHED_YIELD]   = { "sched_yield",   0, 0,               sys_sched_yield },
+    [SYS_PUTCHAR]       = { "putchar",       1, SYSCALL_F_BATCH, sys_putchar },
+};
+
+static int log2_bucket(uint64_t v) {
+    int b = 0;
+    while (v > 1 && b < SYSCALL_HIST_BUCKETS - 1) {
+        v >>= 1;
+        b++;
+    }
+    return b;
+}
+
+static uint64_t syscall_dispatch(uint64_t num, uint64_t a0, uint64_t a1, uint64_t a2,
+                                 uint64_t a3, uint64_t a4, uint64_t a5) {
+    const syscall_desc_t *desc = &syscall_table[num];
+    struct syscall_stats *st = &syscall_stats[num];
+    
+    uint64_t start = read_cycle();
+    uint64_t ret = desc->fn(a0, a1, a2, a3, a4, a5);
+    uint64_t cycles = read_cycle() - start;
+    
+    st->calls++;
+    st->cycles += cycles;
+    st->hist[log2_bucket(cycles)]++;
+    // The full 64 bits: an mmap address can have bit 31 set and still succeed
+    if ((int64_t)ret < 0) {
+        st->errors++;
+    }
+    
+    return ret;
+}
+
+// Returns nonzero when trap.S must take the full-frame path to switch process
+int syscall_handler(struct trap_frame *tf) {
     uint64_t syscall_num = tf->x17;
-    uint64_t arg0 = tf->x10;
-    uint64_t arg1 = tf->x11;
-    uint64_t arg2 = tf->x12;
+    struct hart *h = this_hart();
+    h->stats.traps++;
+    h->stats.syscalls++;
     
-    uint64_t ret = 0;
+    if (syscall_num >= NR_SYSCALLS || !syscall_table[syscall_num].fn) {
+        unknown_syscalls++;
+        pr_debug("unknown syscall %lu at 0x%lx\n", syscall_num, tf->sepc - 4);
+        tf->x10 = -1;
+        return 0;
+    }
     
-    switch (syscall_num) {
-        case SYS_EXIT: {
-            process_exit((int)arg0);
-            ret = 0;
-            break;
-        }
+    process_t *caller = process_current();
+    trace(TRACE_SYSCALL_ENTER, syscall_num, tf->x10);
+    uint64_t ret = syscall_dispatch(syscall_num, tf->x10, tf->x11, tf->x12,
+                                    tf->x13, tf->x14, tf->x15);
+    trace(TRACE_SYSCALL_EXIT, syscall_num, ret);
+    // A deadline task the call woke or admitted may outrank the caller
+    if (h->need_resched) {
+        process_yield();
+    }
+    
+    if (caller && caller->restart) {
+        // Woken for a retry: back up to the ecall with the arguments intact
+        caller->restart = 0;
+        tf->sepc -= 4;
+    } else if (!caller || caller->state != PROC_BLOCKED) {
+        // A caller still blocked gets its result from process_wake
+        tf->x10 = ret;
+    }
+    // Signal delivery and sigreturn rewrite the frame, which needs s0-s11
+    return process_switch_pending() || (caller && signal_work_pending(caller));
+}
+
+int64_t syscall_batched(uint64_t num, const uint64_t args[3]) {
+    if (num >= NR_SYSCALLS || !(syscall_table[num].flags & SYSCALL_F_BATCH) ||
+        syscall_table[num].nargs > 3) {
+        unknown_syscalls++;
+        return -1;
+    }
+    
+    // A cqe's res is as wide as a0, so results keep their upper half
+    return (int64_t)syscall_dispatch(num, args[0], args[1], args[2], 0, 0, 0);
+}
+
+int syscall_get_stats(int num, struct syscall_stats *out) {
+    if (num < 0 || num >= NR_SYSCALLS || !syscall_table[num].fn) {
+        return -1;
+    }
+    
+    const struct syscall_stats *st = &syscall_stats[num];
+    out->calls = st->calls;
+    out->errors = st->errors;
+    out->cycles = st->cycles;
+    for (int i = 0; i < SYSCALL_HIST_BUCKETS; i++) {
+        out->hist[i] = st->hist[i];
+    }
+    return 0;
+}
+
+void syscall_dump_stats(void) {
+    printk("Syscall statistics:\n");
+    for (int i = 0; i < NR_SYSCALLS; i++) {
+        const struct syscall_stats *st = &syscall_stats[i];
+        if (!syscall_table[i].fn || st->calls == 0) continue;
         
-        case SYS_FORK: {
-            ret = process_fork();
-            if (ret > 0) {
-                process_t *child = process_get(ret);
-                if (child) {
-                    child->context.regs[10] = 0;
-                }
+        printk("%s(%d): %lu calls, %lu errors, %lu avg cycles\n",
+               syscall_table[i].name, syscall_table[i].nargs,
+               st->calls, st->errors, st->cycles / st->calls);
+        for (int b = 0; b < SYSCALL_HIST_BUCKETS; b++) {
+            if (st->hist[b]) {
+                printk("    [%lu, %lu): %lu\n", 1UL << b, 1UL << (b + 1), st->hist[b]);
             }
-            break;
-        }
-        
-        case SYS_READ: {
-            ret = fs_read((int)arg0, (void *)arg1, (uint32_t)arg2);
-            break;
         }
-        
-        case SYS_WRITE: {
-            ret = fs_write((int)arg0, (const void *)arg1, (uint32_t)arg2);
-            break;
-        }
-        
-        case SYS_OPEN: {
-            ret = fs_open((const char *)arg0, (int)arg1);
-            break;
-        }
-        
-        case SYS_CLOSE: {
-            ret = fs_close((int)arg0);
-            break;
-        }
-        
-        case SYS_WAIT: {
-            ret = process_wait((int *)arg0);
-            break;
-        }
-        
-        case SYS_EXEC: {
-            ret = process_exec((const char *)arg0);
-            break;
-        }
-        
-        case SYS_GETPID: {
-            process_t *proc = process_current();
-            ret = proc ? proc->pid : -1;
-            break;
-        }
-        
-        case SYS_KILL: {
-            ret = process_kill((int)arg0, (int)arg1);
-            break;
-        }
-        
-        case SYS_PUTCHAR: {
-            printk("%c", (char)arg0);
-            ret = 0;
-            break;
-        }
-        
-        default:
-            printk("%lu: Function not implemented!\n", syscall_num);
-            ret = -1;
-            break;
     }
-   
-    tf->x10 = ret;
+    printk("unknown syscalls: %lu\n", unknown_syscalls);
 }
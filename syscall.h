@@ -3,6 +3,62 @@
 
 #include "trap.h"
 
-void syscall_handler(struct trap_frame *tf);
+#define SYS_EXIT          1
+#define SYS_FORK          2
+#define SYS_READ          3
+#define SYS_WRITE         4
+#define SYS_OPEN          5
+#define SYS_CLOSE         6
+#define SYS_WAIT          7
+#define SYS_EXEC          8
+#define SYS_GETPID        9
+#define SYS_KILL          10
+#define SYS_SYSSTAT       11
+#define SYS_RING_SETUP    12
+#define SYS_RING_ENTER    13
+#define SYS_FUTEX         14
+#define SYS_NANOSLEEP     15
+#define SYS_CLOCK_GETTIME 16
+#define SYS_EPOLL_CREATE  17
+#define SYS_EPOLL_CTL     18
+#define SYS_EPOLL_WAIT    19
+#define SYS_SIGACTION     20
+#define SYS_SIGPROCMASK   21
+#define SYS_SIGRETURN     22
+#define SYS_LOGLEVEL      23
+#define SYS_PROFILE       24
+#define SYS_PERF_OPEN     25
+#define SYS_PERF_CTL      26
+#define SYS_TRACE         27
+#define SYS_CLONE         28
+#define SYS_GETTID        29
+#define SYS_EXIT_GROUP    30
+#define SYS_SHM_OPEN      31
+#define SYS_SHM_UNLINK    32
+#define SYS_FTRUNCATE     33
+#define SYS_MMAP          34
+#define SYS_MUNMAP        35
+#define SYS_FCNTL         36
+#define SYS_PRCTL         37
+#define SYS_SCHED_SETATTR 38
+#define SYS_SCHED_GETATTR 39
+#define SYS_SCHED_YIELD   40
+#define SYS_PUTCHAR       100
+
+#define NR_SYSCALLS (SYS_PUTCHAR + 1)
+#define SYSCALL_HIST_BUCKETS 24
+
+// Per-syscall counters; hist[i] counts calls that took [2^i, 2^(i+1)) cycles
+struct syscall_stats {
+    uint64_t calls;
+    uint64_t errors;
+    uint64_t cycles;
+    uint64_t hist[SYSCALL_HIST_BUCKETS];
+};
+
+int syscall_handler(struct trap_frame *tf);
+int64_t syscall_batched(uint64_t num, const uint64_t args[3]);
+int syscall_get_stats(int num, struct syscall_stats *out);
+void syscall_dump_stats(void);
 
 #endif
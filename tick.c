@@ -0,0 +1,75 @@
+#include "tick.h"
+#include "timer.h"
+#include "process.h"
+#include "hart.h"
+#include "riscv.h"
+#include "printk.h"
+#include <stddef.h>
+
+#define LOG_SUBSYS LOG_TIMER
+
+#ifdef CONFIG_NO_HZ_IDLE
+#define NO_HZ_IDLE 1
+#else
+#define NO_HZ_IDLE 0
+#endif
+
+static struct timer ticks[MAX_HARTS];
+static uint64_t tick_period;
+
+static uint64_t ticks_stopped;
+
+// Round robin: whatever is ready runs next, the current process queues behind it
+static void tick_fn(struct timer *t) {
+    this_hart()->stats.ticks++;
+    
+    // After a long stretch with interrupts off, don't replay missed ticks
+    uint64_t next = t->expires + tick_period;
+    uint64_t now = read_time();
+    timer_add(t, next > now ? next : now + tick_period, tick_fn, NULL);
+    process_yield();
+}
+
+void tick_start(void) {
+    struct timer *t = &ticks[hart_id()];
+    tick_period = timer_ns_to_ticks(NSEC_PER_SEC / CONFIG_HZ);
+    timer_add(t, read_time() + tick_period, tick_fn, NULL);
+    pr_info("tick: %d Hz%s\n", CONFIG_HZ, NO_HZ_IDLE ? ", stopped on idle harts" : "");
+}
+
+void tick_stop(void) {
+    timer_cancel(&ticks[hart_id()]);
+}
+
+/*
+ * Idles the hart until an interrupt. A running tick is stopped first and
+ * the SBI timer reprogrammed for the next real deadline; it restarts a
+ * full period after the wakeup, so the slice of whatever runs next is
+ * whole. Every idle period counts toward the hart's residency.
+ */
+void tick_idle(void) {
+    struct hart *h = this_hart();
+    struct timer *t = &ticks[h->id];
+    int stopped = NO_HZ_IDLE && timer_pending(t);
+    if (stopped) {
+        timer_cancel(t);
+        ticks_stopped++;
+    }
+    timer_reprogram();
+    
+    uint64_t cycles = read_cycle();
+    uint64_t start = read_time();
+    idle_wait();
+    h->stats.idle_cycles += read_cycle() - cycles;
+    h->stats.idle_time += read_time() - start;
+    h->stats.idle_entries++;
+    
+    if (stopped && !timer_pending(t)) {
+        timer_add(t, read_time() + tick_period, tick_fn, NULL);
+    }
+}
+
+void tick_dump_stats(void) {
+    if (!tick_period) return;
+    printk("tick: %d Hz, stopped for %lu idle periods\n", CONFIG_HZ, ticks_stopped);
+}
@@ -0,0 +1,21 @@
+#ifndef TICK_H
+#define TICK_H
+
+#include <stdint.h>
+
+/*
+ * The scheduler tick: a per-hart periodic timer that rotates the run
+ * queue, giving round robin a time slice. With CONFIG_NO_HZ_IDLE it is
+ * stopped while a hart idles, so an idle hart sleeps until the next
+ * real timer instead of waking CONFIG_HZ times a second.
+ */
+#ifndef CONFIG_HZ
+#define CONFIG_HZ 100
+#endif
+
+void tick_start(void);
+void tick_stop(void);
+void tick_idle(void);
+void tick_dump_stats(void);
+
+#endif
@@ -0,0 +1,228 @@
+#include "timer.h"
+#include "trap.h"
+#include "riscv.h"
+#include "vdso.h"
+#include "printk.h"
+#include <stddef.h>
+
+static struct timer *wheel[TIMER_LEVELS][TIMER_WHEEL_SIZE];
+
+// Granule up to which the wheel has been processed
+static uint64_t wheel_clk;
+
+// Deadline currently programmed into the SBI timer
+static uint64_t programmed = UINT64_MAX;
+
+static uint64_t timers_run;
+static uint64_t timers_coalesced;
+
+// Latest time t may fire, saturating for timers that never need to
+static uint64_t timer_latest(const struct timer *t) {
+    uint64_t latest = t->expires + t->slack;
+    return latest < t->expires ? UINT64_MAX : latest;
+}
+
+static void wheel_insert(struct timer *t) {
+    uint64_t g = t->expires >> TIMER_SHIFT;
+    uint64_t delta = g > wheel_clk ? g - wheel_clk : 0;
+    int level = 0;
+    
+    while (level < TIMER_LEVELS - 1 &&
+           delta >= (1ULL << (TIMER_WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    
+    // Beyond the top level's range: park it in the farthest slot and let
+    // it cascade down once the wheel gets there
+    uint64_t range = 1ULL << (TIMER_WHEEL_BITS * TIMER_LEVELS);
+    if (delta >= range) {
+        g = wheel_clk + range - 1;
+    }
+    if (g < wheel_clk) {
+        g = wheel_clk;
+    }
+    
+    struct timer **slot = &wheel[level][(g >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK];
+    t->next = *slot;
+    if (t->next) {
+        t->next->pprev = &t->next;
+    }
+    t->pprev = slot;
+    *slot = t;
+}
+
+static void wheel_unlink(struct timer *t) {
+    *t->pprev = t->next;
+    if (t->next) {
+        t->next->pprev = t->pprev;
+    }
+    t->next = NULL;
+    t->pprev = NULL;
+}
+
+/*
+ * Earliest time the wheel needs attention: the minimum of every pending
+ * timer's latest firing time. Each level is scanned forward from the
+ * clock, and a slot is only opened while the first tick it can hold is
+ * still ahead of the best deadline found, so an empty slot costs one
+ * load and the scan stops at the first occupied one. Slack can make a
+ * later slot hold the tighter bound, which only extends the scan by the
+ * slack of what was found. Higher levels need no wakeup of their own at
+ * slot boundaries either, because timer_interrupt cascades every slot
+ * the clock crossed, however far it jumped; an idle hart then sleeps
+ * straight through to the next timer that matters.
+ */
+static uint64_t wheel_next_deadline(void) {
+    uint64_t best = UINT64_MAX;
+    
+    for (int level = 0; level < TIMER_LEVELS; level++) {
+        int shift = TIMER_WHEEL_BITS * level;
+        uint64_t base = wheel_clk >> shift;
+        // Above level 0 the clock's own slot has already cascaded down
+        uint64_t first = level > 0;
+        
+        for (uint64_t k = first; k < first + TIMER_WHEEL_SIZE; k++) {
+            if (((base + k) << shift << TIMER_SHIFT) >= best) break;
+            for (struct timer *t = wheel[level][(base + k) & TIMER_WHEEL_MASK]; t; t = t->next) {
+                uint64_t latest = timer_latest(t);
+                if (latest < best) best = latest;
+            }
+        }
+    }
+    
+    return best;
+}
+
+// Drops a stale deadline left behind by timer_cancel, e.g. before idling
+void timer_reprogram(void) {
+    uint64_t next = wheel_next_deadline();
+    if (next != programmed) {
+        programmed = next;
+        trap_set_timer(next);
+    }
+}
+
+void timer_init(void) {
+    wheel_clk = read_time() >> TIMER_SHIFT;
+    printk("Timer wheel: %d levels x %d slots, %lu ticks/granule\n",
+           TIMER_LEVELS, TIMER_WHEEL_SIZE, 1UL << TIMER_SHIFT);
+}
+
+void timer_add(struct timer *t, uint64_t expires, timer_fn_t fn, void *arg) {
+    timer_add_slack(t, expires, 0, fn, arg);
+}
+
+// Fires t between expires and expires + slack, whichever suits a wakeup
+void timer_add_slack(struct timer *t, uint64_t expires, uint64_t slack,
+                     timer_fn_t fn, void *arg) {
+    if (timer_pending(t)) {
+        wheel_unlink(t);
+    }
+    
+    t->expires = expires;
+    t->slack = slack;
+    t->fn = fn;
+    t->arg = arg;
+    wheel_insert(t);
+    
+    uint64_t latest = timer_latest(t);
+    if (latest < programmed) {
+        programmed = latest;
+        trap_set_timer(latest);
+    }
+}
+
+// A stale programmed deadline only costs one spurious interrupt
+void timer_cancel(struct timer *t) {
+    if (timer_pending(t)) {
+        wheel_unlink(t);
+    }
+}
+
+static void run_slot(struct timer **slot, uint64_t now) {
+    struct timer *list = *slot;
+    *slot = NULL;
+    if (list) {
+        list->pprev = &list;
+    }
+    
+    while (list) {
+        struct timer *t = list;
+        wheel_unlink(t);
+        
+        if (t->expires <= now) {
+            // Due, but riding on a wakeup some other timer forced
+            timers_coalesced += now < timer_latest(t) && t->slack;
+            timers_run++;
+            t->fn(t);
+        } else {
+            wheel_insert(t);
+        }
+    }
+}
+
+void timer_interrupt(void) {
+    uint64_t now = read_time();
+    uint64_t now_g = now >> TIMER_SHIFT;
+    uint64_t old_clk = wheel_clk;
+    
+    wheel_clk = now_g;
+    programmed = UINT64_MAX;
+    
+    for (int level = 0; level < TIMER_LEVELS; level++) {
+        int shift = TIMER_WHEEL_BITS * level;
+        uint64_t from = old_clk >> shift;
+        uint64_t to = now_g >> shift;
+        
+        // No boundary crossed here means none crossed above either
+        if (level > 0 && from == to) break;
+        
+        uint64_t n = to - from + 1;
+        if (n > TIMER_WHEEL_SIZE) n = TIMER_WHEEL_SIZE;
+        
+        for (uint64_t i = 0; i < n; i++) {
+            run_slot(&wheel[level][(from + i) & TIMER_WHEEL_MASK], now);
+        }
+    }
+    
+    timer_reprogram();
+}
+
+void timer_dump_stats(void) {
+    if (!timers_run) return;
+    printk("timer: %lu expired, %lu coalesced into an earlier wakeup\n",
+           timers_run, timers_coalesced);
+}
+
+uint64_t timer_ns_to_ticks(uint64_t ns) {
+    return ns / NSEC_PER_SEC * TIMEBASE_FREQ +
+           ns % NSEC_PER_SEC * TIMEBASE_FREQ / NSEC_PER_SEC;
+}
+
+uint64_t timer_ticks_to_ns(uint64_t ticks) {
+    return ticks / TIMEBASE_FREQ * NSEC_PER_SEC +
+           ticks % TIMEBASE_FREQ * NSEC_PER_SEC / TIMEBASE_FREQ;
+}
+
+uint64_t timespec_to_ticks(const struct timespec *ts) {
+    if (ts->tv_sec < 0 || ts->tv_nsec < 0) return 0;
+    return (uint64_t)ts->tv_sec * TIMEBASE_FREQ + timer_ns_to_ticks(ts->tv_nsec);
+}
+
+int timer_clock_gettime(int clk, struct timespec *ts) {
+    uint64_t ns = timer_ticks_to_ns(read_time() - vdso_page.boot_time);
+    
+    switch (clk) {
+        case CLOCK_MONOTONIC:
+            break;
+        case CLOCK_REALTIME:
+            ns += vdso_page.boot_realtime_ns;
+            break;
+        default:
+            return -1;
+    }
+    
+    ts->tv_sec = ns / NSEC_PER_SEC;
+    ts->tv_nsec = ns % NSEC_PER_SEC;
+    return 0;
+}
@@ -0,0 +1,67 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+
+/*
+ * Hierarchical timing wheel. Expiry times are in time CSR ticks; the
+ * wheel buckets them into granules of 2^TIMER_SHIFT ticks, but a timer
+ * fires at its exact expiry because the SBI timer is programmed for the
+ * earliest pending deadline rather than a periodic tick.
+ *
+ * A timer may carry slack: it is due at expires but may fire as late as
+ * expires + slack. The SBI timer is programmed for the earliest such
+ * latest time, and every interrupt runs all timers already due, so
+ * timers whose windows overlap share a single wakeup.
+ */
+#define TIMER_SHIFT      10
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SIZE (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SIZE - 1)
+#define TIMER_LEVELS     4
+
+// Slack a process gets for its sleeps and timeouts unless it sets its own
+#ifndef CONFIG_TIMER_SLACK_NS
+#define CONFIG_TIMER_SLACK_NS 50000
+#endif
+
+#define CLOCK_REALTIME  0
+#define CLOCK_MONOTONIC 1
+
+#define NSEC_PER_SEC 1000000000ULL
+
+struct timespec {
+    int64_t tv_sec;
+    int64_t tv_nsec;
+};
+
+struct timer;
+typedef void (*timer_fn_t)(struct timer *t);
+
+struct timer {
+    uint64_t expires;
+    uint64_t slack;
+    timer_fn_t fn;
+    void *arg;
+    struct timer *next;
+    struct timer **pprev;
+};
+
+void timer_init(void);
+void timer_add(struct timer *t, uint64_t expires, timer_fn_t fn, void *arg);
+void timer_add_slack(struct timer *t, uint64_t expires, uint64_t slack,
+                     timer_fn_t fn, void *arg);
+void timer_cancel(struct timer *t);
+void timer_interrupt(void);
+void timer_reprogram(void);
+void timer_dump_stats(void);
+uint64_t timer_ns_to_ticks(uint64_t ns);
+uint64_t timer_ticks_to_ns(uint64_t ticks);
+uint64_t timespec_to_ticks(const struct timespec *ts);
+int timer_clock_gettime(int clk, struct timespec *ts);
+
+static inline int timer_pending(const struct timer *t) {
+    return t->pprev != 0;
+}
+
+#endif
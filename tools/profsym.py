@@ -0,0 +1,104 @@
+#!/usr/bin/env python3
+"""Symbolize the kernel's PROF_DUMP output into flame-graph folded stacks.
+
+Reads a serial log (file or stdin), takes every sample between
+PROFILE-BEGIN and PROFILE-END, resolves addresses against kernel.elf's
+symbol table and prints one "frame;frame;...;leaf count" line per
+distinct stack, ready for flamegraph.pl or speedscope:
+
+    tools/profsym.py build/kernel.elf serial.log > profile.folded
+    flamegraph.pl profile.folded > profile.svg
+
+User code is linked into the kernel image, so one symbol table covers
+both modes. The root frame says which mode and process was sampled.
+"""
+
+import argparse
+import bisect
+import collections
+import shutil
+import subprocess
+import sys
+
+NM_CANDIDATES = ("riscv64-linux-gnu-nm", "riscv64-unknown-elf-nm", "llvm-nm", "nm")
+
+
+def find_nm(requested):
+    if requested:
+        return requested
+    for tool in NM_CANDIDATES:
+        if shutil.which(tool):
+            return tool
+    sys.exit("profsym: no nm found, pass --nm")
+
+
+def load_symbols(nm, elf):
+    out = subprocess.run([nm, "-n", "-S", "--defined-only", elf],
+                         check=True, capture_output=True, text=True).stdout
+    addrs, names = [], []
+    for line in out.splitlines():
+        parts = line.split()
+        # "addr size type name", or "addr type name" for sizeless symbols
+        if len(parts) < 3 or parts[-2].lower() not in ("t", "w"):
+            continue
+        addrs.append(int(parts[0], 16))
+        names.append(parts[-1])
+    return addrs, names
+
+
+class Symbolizer:
+    def __init__(self, addrs, names):
+        self.addrs = addrs
+        self.names = names
+
+    def __call__(self, addr):
+        i = bisect.bisect_right(self.addrs, addr) - 1
+        if i < 0:
+            return "0x%x" % addr
+        return self.names[i]
+
+
+def parse_samples(lines):
+    inside = False
+    for line in lines:
+        line = line.strip()
+        if line.startswith("PROFILE-BEGIN"):
+            inside = True
+        elif line.startswith("PROFILE-END"):
+            inside = False
+        elif inside and line.startswith("P "):
+            # P <hart> <pid> <u|k> <time> <pc> [return addresses...]
+            fields = line.split()
+            pid, mode = int(fields[2]), fields[3]
+            pc = int(fields[5], 16)
+            frames = [int(f, 16) for f in fields[6:]]
+            yield pid, mode, pc, frames
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("elf", help="kernel.elf the samples came from")
+    ap.add_argument("log", nargs="?", help="serial log (default: stdin)")
+    ap.add_argument("--nm", help="nm binary to read the symbol table with")
+    ap.add_argument("--no-pid", action="store_true",
+                    help="merge processes instead of rooting stacks at pid")
+    args = ap.parse_args()
+
+    sym = Symbolizer(*load_symbols(find_nm(args.nm), args.elf))
+    log = open(args.log, errors="replace") if args.log else sys.stdin
+
+    stacks = collections.Counter()
+    for pid, mode, pc, frames in parse_samples(log):
+        # Return addresses point past the call; step back into it
+        names = [sym(pc)] + [sym(ra - 1) for ra in frames]
+        root = "kernel" if mode == "k" else "user"
+        if not args.no_pid:
+            root += ";pid %d" % pid
+        stacks[root + ";" + ";".join(reversed(names))] += 1
+
+    for stack, count in sorted(stacks.items()):
+        print("%s %d" % (stack, count))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+"""Convert the kernel's binary trace records into Chrome trace JSON.
+
+Reads a serial log holding a TRACE_DUMP (the "T <hex>" lines between
+TRACE-BEGIN and TRACE-END), or with --raw a file of records as returned
+by TRACE_READ, and writes a JSON trace that chrome://tracing and
+ui.perfetto.dev open directly:
+
+    tools/trace2json.py serial.log > trace.json
+    tools/trace2json.py --raw trace.bin > trace.json
+
+Each process gets a track with its syscalls as slices and fs, fault and
+lifecycle events as instants. A "harts" process has one track per hart
+showing which process the scheduler ran there.
+"""
+
+import argparse
+import json
+import os
+import re
+import struct
+import sys
+
+# struct trace_record in trace_uapi.h
+RECORD = struct.Struct("<QHBxiQQ")
+
+CLASS_NAMES = {0x01: "syscall", 0x02: "sched", 0x04: "proc", 0x08: "fs", 0x10: "fault"}
+
+SYSCALL_ENTER = 0x0100
+SYSCALL_EXIT = 0x0101
+SCHED_SWITCH = 0x0200
+SCHED_DL_MISS = 0x0201
+PROC_CREATE = 0x0400
+PROC_EXIT = 0x0401
+FS_OPEN = 0x0800
+FS_READ = 0x0801
+FS_WRITE = 0x0802
+PAGE_FAULT = 0x1000
+
+INSTANTS = {
+    SCHED_DL_MISS: ("deadline miss", ("pid", "late_ns")),
+    PROC_CREATE: ("create", ("pid", "ppid")),
+    PROC_EXIT: ("exit", ("pid", "code")),
+    FS_OPEN: ("open", ("fd", "file")),
+    FS_READ: ("read", ("fd", "count")),
+    FS_WRITE: ("write", ("fd", "count")),
+    PAGE_FAULT: ("page fault", ("scause", "stval")),
+}
+
+HARTS_PID = -1
+
+
+def syscall_names():
+    """SYS_* numbers from the kernel's own header, so the two can't drift."""
+    names = {}
+    header = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "syscall.h")
+    try:
+        with open(header) as f:
+            for m in re.finditer(r"#define SYS_(?!CALL_)(\w+)\s+(\d+)", f.read()):
+                names[int(m.group(2))] = m.group(1).lower()
+    except OSError:
+        pass
+    return names
+
+
+def records_from_log(lines):
+    inside = False
+    for line in lines:
+        line = line.strip()
+        if line.startswith("TRACE-BEGIN"):
+            inside = True
+        elif line.startswith("TRACE-END"):
+            inside = False
+        elif inside and line.startswith("T "):
+            yield RECORD.unpack(bytes.fromhex(line[2:]))
+
+
+def records_from_raw(data):
+    usable = len(data) - len(data) % RECORD.size
+    for off in range(0, usable, RECORD.size):
+        yield RECORD.unpack_from(data, off)
+
+
+def to_chrome(records, timebase, names):
+    # Harts drain one after another, so put everything back in time order
+    records = sorted(records, key=lambda r: r[0])
+    if not records:
+        return []
+    t0 = records[0][0]
+
+    def us(t):
+        return (t - t0) * 1e6 / timebase
+
+    events = [{"ph": "M", "name": "process_name", "pid": HARTS_PID,
+               "args": {"name": "harts"}}]
+    seen = set()
+    running = {}
+
+    for time, event, hart, pid, a0, a1 in records:
+        if pid not in seen:
+            seen.add(pid)
+            events.append({"ph": "M", "name": "process_name", "pid": pid,
+                           "args": {"name": "pid %d" % pid}})
+        base = {"ts": us(time), "pid": pid, "tid": pid}
+
+        if event == SYSCALL_ENTER:
+            events.append(dict(base, ph="B", name=names.get(a0, "syscall %d" % a0),
+                               cat="syscall", args={"a0": a0}))
+        elif event == SYSCALL_EXIT:
+            ret = a1 - (1 << 64) if a1 >> 63 else a1
+            events.append(dict(base, ph="E", cat="syscall", args={"ret": ret}))
+        elif event == SCHED_SWITCH:
+            # One slice per stint on the hart, closed by the next switch
+            if hart in running:
+                start, prev = running[hart]
+                events.append({"ph": "X", "name": "pid %d" % prev, "cat": "sched",
+                               "pid": HARTS_PID, "tid": hart, "ts": us(start),
+                               "dur": us(time) - us(start)})
+            running[hart] = (time, a1)
+        elif event in INSTANTS:
+            name, keys = INSTANTS[event]
+            events.append(dict(base, ph="i", s="t", name=name,
+                               cat=CLASS_NAMES.get(event >> 8, "other"),
+                               args={keys[0]: a0, keys[1]: a1}))
+        else:
+            events.append(dict(base, ph="i", s="t", name="event 0x%x" % event,
+                               args={"a0": a0, "a1": a1}))
+
+    end = records[-1][0]
+    for hart, (start, pid) in running.items():
+        events.append({"ph": "X", "name": "pid %d" % pid, "cat": "sched",
+                       "pid": HARTS_PID, "tid": hart, "ts": us(start),
+                       "dur": us(end) - us(start)})
+    return events
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("input", nargs="?", help="serial log or raw records (default: stdin)")
+    ap.add_argument("--raw", action="store_true",
+                    help="input is binary trace_record structs, not a log")
+    ap.add_argument("--timebase", type=int, default=10000000,
+                    help="rdtime ticks per second (read from TRACE-BEGIN in logs)")
+    args = ap.parse_args()
+
+    timebase = args.timebase
+    if args.raw:
+        src = open(args.input, "rb") if args.input else sys.stdin.buffer
+        records = list(records_from_raw(src.read()))
+    else:
+        src = open(args.input, errors="replace") if args.input else sys.stdin
+        lines = src.readlines()
+        for line in lines:
+            m = re.search(r"TRACE-BEGIN timebase=(\d+)", line)
+            if m:
+                timebase = int(m.group(1))
+        records = list(records_from_log(lines))
+
+    json.dump({"traceEvents": to_chrome(records, timebase, syscall_names()),
+               "displayTimeUnit": "ns"}, sys.stdout)
+    sys.stdout.write("\n")
+
+
+if __name__ == "__main__":
+    main()
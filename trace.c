@@ -0,0 +1,126 @@
+#include "trace.h"
+#include "hart.h"
+#include "boot.h"
+#include "printk.h"
+#include "riscv.h"
+
+/*
+ * Per-hart buffers with the same discipline as the profiler's: the
+ * owning hart is the only producer and kernel code runs with interrupts
+ * off, so appending needs no lock. A full buffer drops new records and
+ * counts them, leaving what is already there a consistent prefix.
+ */
+struct trace_buf {
+    uint32_t head;
+    uint32_t tail;
+    uint64_t dropped;
+};
+
+uint32_t trace_mask;
+
+static struct trace_buf trace_bufs[MAX_HARTS];
+static struct trace_record trace_records[MAX_HARTS][TRACE_RECORDS] __noinit;
+
+static uint64_t trace_total;
+
+_Static_assert(sizeof(struct trace_record) == 32, "trace record layout is ABI");
+
+void trace_emit(uint16_t event, uint64_t a0, uint64_t a1) {
+    uint64_t hart = hart_id();
+    struct trace_buf *b = &trace_bufs[hart];
+    if (b->head - b->tail >= TRACE_RECORDS) {
+        b->dropped++;
+        return;
+    }
+    
+    struct trace_record *r = &trace_records[hart][b->head % TRACE_RECORDS];
+    r->time = read_time();
+    r->event = event;
+    r->hart = hart;
+    r->pad = 0;
+    r->pid = this_hart()->running_pid;
+    r->args[0] = a0;
+    r->args[1] = a1;
+    b->head++;
+    trace_total++;
+}
+
+static void trace_start(uint64_t mask) {
+    for (int i = 0; i < MAX_HARTS; i++) {
+        trace_bufs[i].head = trace_bufs[i].tail = 0;
+        trace_bufs[i].dropped = 0;
+    }
+    trace_mask = mask ? mask & TRACE_CLASS_ALL : TRACE_CLASS_ALL;
+}
+
+// Drains up to max unread records into buf, hart by hart
+static int trace_read(struct trace_record *buf, uint64_t max) {
+    uint64_t n = 0;
+    for (int i = 0; i < MAX_HARTS && n < max; i++) {
+        struct trace_buf *b = &trace_bufs[i];
+        while (b->tail != b->head && n < max) {
+            buf[n++] = trace_records[i][b->tail % TRACE_RECORDS];
+            b->tail++;
+        }
+    }
+    return (int)n;
+}
+
+/*
+ * The console is the only way out of the machine, so each record goes
+ * out as its 32 raw bytes in hex, one per line between markers, for
+ * tools/trace2json.py to decode.
+ */
+static int trace_dump(void) {
+    static const char digits[] = "0123456789abcdef";
+    char line[2 * sizeof(struct trace_record) + 1];
+    int n = 0;
+    uint64_t dropped = 0;
+    for (int i = 0; i < MAX_HARTS; i++) {
+        dropped += trace_bufs[i].dropped;
+    }
+    
+    printk("TRACE-BEGIN timebase=%lu dropped=%lu\n", TIMEBASE_FREQ, dropped);
+    for (int i = 0; i < MAX_HARTS; i++) {
+        struct trace_buf *b = &trace_bufs[i];
+        for (; b->tail != b->head; b->tail++, n++) {
+            const uint8_t *p = (const uint8_t *)&trace_records[i][b->tail % TRACE_RECORDS];
+            for (unsigned j = 0; j < sizeof(struct trace_record); j++) {
+                line[2 * j] = digits[p[j] >> 4];
+                line[2 * j + 1] = digits[p[j] & 0xf];
+            }
+            line[sizeof(line) - 1] = '\0';
+            printk("T %s\n", line);
+        }
+    }
+    printk("TRACE-END records=%d\n", n);
+    return n;
+}
+
+int trace_ctl(int cmd, uint64_t arg, void *buf) {
+    switch (cmd) {
+        case TRACE_START:
+            trace_start(arg);
+            return 0;
+        case TRACE_STOP:
+            trace_mask = 0;
+            return 0;
+        case TRACE_READ:
+            if (!buf) return -1;
+            return trace_read((struct trace_record *)buf, arg);
+        case TRACE_DUMP:
+            return trace_dump();
+        default:
+            return -1;
+    }
+}
+
+void trace_dump_stats(void) {
+    if (!trace_total) return;
+    uint64_t dropped = 0;
+    for (int i = 0; i < MAX_HARTS; i++) {
+        dropped += trace_bufs[i].dropped;
+    }
+    printk("trace: %lu records, %lu dropped%s\n", trace_total, dropped,
+           trace_mask ? ", running" : "");
+}
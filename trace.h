@@ -0,0 +1,26 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include "trace_uapi.h"
+
+#define TRACE_RECORDS 2048
+
+extern uint32_t trace_mask;
+
+/*
+ * A tracepoint is one load and one branch while its class is off; the
+ * record is only built in trace_emit, out of line.
+ */
+#define trace(ev, a0, a1)                                                   \
+    do {                                                                    \
+        if (__builtin_expect(trace_mask & ((ev) >> 8), 0)) {                \
+            trace_emit((ev), (uint64_t)(a0), (uint64_t)(a1));               \
+        }                                                                   \
+    } while (0)
+
+void trace_emit(uint16_t event, uint64_t a0, uint64_t a1);
+int trace_ctl(int cmd, uint64_t arg, void *buf);
+void trace_dump_stats(void);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef TRACE_UAPI_H
+#define TRACE_UAPI_H
+
+#include <stdint.h>
+
+/*
+ * The trace syscall's ABI, shared by the kernel and user programs. It
+ * holds no kernel state, so unistd.h can include it without picking up
+ * the trace() tracepoint macro.
+ */
+
+// Commands for the trace syscall
+#define TRACE_START 0
+#define TRACE_STOP  1
+#define TRACE_READ  2
+#define TRACE_DUMP  3
+
+// Event classes, enabled as a mask by TRACE_START
+#define TRACE_CLASS_SYSCALL 0x01
+#define TRACE_CLASS_SCHED   0x02
+#define TRACE_CLASS_PROC    0x04
+#define TRACE_CLASS_FS      0x08
+#define TRACE_CLASS_FAULT   0x10
+#define TRACE_CLASS_ALL     0x1f
+
+/*
+ * Event IDs carry their class in the high byte so the enabled check is
+ * a constant mask. The numbering is ABI: tools/trace2json.py decodes it.
+ */
+#define TRACE_EV(class, n) ((class) << 8 | (n))
+
+#define TRACE_SYSCALL_ENTER TRACE_EV(TRACE_CLASS_SYSCALL, 0)  // num, a0
+#define TRACE_SYSCALL_EXIT  TRACE_EV(TRACE_CLASS_SYSCALL, 1)  // num, ret
+#define TRACE_SCHED_SWITCH  TRACE_EV(TRACE_CLASS_SCHED, 0)    // prev pid, next pid
+#define TRACE_SCHED_DL_MISS TRACE_EV(TRACE_CLASS_SCHED, 1)    // pid, ns late
+#define TRACE_PROC_CREATE   TRACE_EV(TRACE_CLASS_PROC, 0)     // pid, ppid
+#define TRACE_PROC_EXIT     TRACE_EV(TRACE_CLASS_PROC, 1)     // pid, code
+#define TRACE_FS_OPEN       TRACE_EV(TRACE_CLASS_FS, 0)       // fd, file index
+#define TRACE_FS_READ       TRACE_EV(TRACE_CLASS_FS, 1)       // fd, count
+#define TRACE_FS_WRITE      TRACE_EV(TRACE_CLASS_FS, 2)       // fd, count
+#define TRACE_PAGE_FAULT    TRACE_EV(TRACE_CLASS_FAULT, 0)    // scause, stval
+
+// Fixed-size binary record, little-endian as the hart stores it
+struct trace_record {
+    uint64_t time;
+    uint16_t event;
+    uint8_t hart;
+    uint8_t pad;
+    int32_t pid;
+    uint64_t args[2];
+};
+
+#endif
@@ -1,39 +1,157 @@
 #include "trap.h"
 #include "printk.h"
 #include "syscall.h"
+#include "plic.h"
+#include "riscv.h"
+#include "sbi.h"
+#include "process.h"
+#include "timer.h"
+#include "signal.h"
+#include "hart.h"
+#include "boot.h"
+#include "profile.h"
+#include "trace.h"
 
-extern void trap_vector(void);
+#define STVEC_MODE_VECTORED 1
+
+#define SIE_SSIE (1UL << 1)
+#define SIE_STIE (1UL << 5)
+
+extern void trap_vector_table(void);
+
+static uint8_t trap_stacks[MAX_HARTS][TRAP_STACK_SIZE] __noinit __attribute__((aligned(16)));
+
+static struct irq_stats timer_stats;
+static struct irq_stats software_stats;
+static uint64_t timer_deadline = UINT64_MAX;
 
 void trap_init(void) {
     printk("Initializing trap handlers...\n");
+    hart_init(trap_stacks[hart_id()] + TRAP_STACK_SIZE);
+    
+    uint64_t tvec = (uint64_t)trap_vector_table;
+    asm volatile("csrw stvec, %0" :: "r"(tvec | STVEC_MODE_VECTORED));
     
-    uint64_t tvec = (uint64_t)trap_vector;
-    asm volatile("csrw stvec, %0" :: "r"(tvec));
+    // sscratch == 0 marks "already in the kernel" for trap_vector
+    asm volatile("csrw sscratch, zero");
+    
+    trap_set_timer(UINT64_MAX);
+    plic_init();
+    plic_init_hart();
+    asm volatile("csrs sie, %0" :: "r"(SIE_SSIE | SIE_STIE));
     
     asm volatile("csrsi sstatus, 0x2");
     
-    printk("Trap vector at: 0x%lx\n", tvec);
+    printk("Trap vector at: 0x%lx (vectored)\n", tvec);
     printk("Traps initialized!\n");
 }
 
+void *trap_kernel_stack(void) {
+    return (void *)this_hart()->kernel_sp;
+}
+
+void trap_set_timer(uint64_t deadline) {
+    timer_deadline = deadline;
+    sbi_set_timer(deadline);
+}
+
+static void irq_enter(void) {
+    struct hart *h = this_hart();
+    h->irq_depth++;
+    h->stats.traps++;
+    h->stats.interrupts++;
+}
+
+static void irq_exit(void) {
+    this_hart()->irq_depth--;
+}
+
+void trap_timer_interrupt(struct trap_frame *tf) {
+    uint64_t start = read_cycle();
+    uint64_t now = read_time();
+    uint64_t latency = now > timer_deadline ? now - timer_deadline : 0;
+    
+    irq_enter();
+    timer_interrupt();
+    profile_tick(tf);
+    irq_exit();
+    
+    irq_stats_record(&timer_stats, read_cycle() - start, latency);
+    process_switch_frame(tf);
+}
+
+void trap_software_interrupt(struct trap_frame *tf) {
+    uint64_t start = read_cycle();
+    
+    irq_enter();
+    asm volatile("csrc sip, %0" :: "r"(SIP_SSIP));
+    irq_exit();
+    
+    irq_stats_record(&software_stats, read_cycle() - start, 0);
+    process_switch_frame(tf);
+}
+
+void trap_external_interrupt(struct trap_frame *tf) {
+    irq_enter();
+    plic_dispatch();
+    irq_exit();
+    process_switch_frame(tf);
+}
+
+void trap_dump_irq_stats(void) {
+    printk("Interrupt statistics:\n");
+    if (timer_stats.count) {
+        printk("  timer: %lu, avg %lu cycles, avg latency %lu ticks, max latency %lu ticks\n",
+               timer_stats.count, timer_stats.cycles / timer_stats.count,
+               timer_stats.latency / timer_stats.count, timer_stats.max_latency);
+    }
+    if (software_stats.count) {
+        printk("  software: %lu, avg %lu cycles\n",
+               software_stats.count, software_stats.cycles / software_stats.count);
+    }
+    plic_dump_stats();
+}
+
+static int exception_signal(uint64_t scause) {
+    switch (scause) {
+        case 2:
+            return SIGILL;
+        case 3:
+            return SIGTRAP;
+        case 0:
+        case 4:
+        case 6:
+            return SIGBUS;
+        default:
+            return SIGSEGV;
+    }
+}
+
 void trap_handler(struct trap_frame *tf) {
-    uint64_t scause, sepc, stval;
+    this_hart()->stats.traps++;
+    uint64_t scause = tf->scause;
+    uint64_t sepc = tf->sepc;
+    uint64_t stval = tf->stval;
     
-    asm volatile("csrr %0, scause" : "=r"(scause));
-    asm volatile("csrr %0, sepc" : "=r"(sepc));
-    asm volatile("csrr %0, stval" : "=r"(stval));
+    if (scause == 12 || scause == 13 || scause == 15) {
+        trace(TRACE_PAGE_FAULT, scause, stval);
+    }
     
     if (scause & (1ULL << 63)) {
+        // Timer, software and external interrupts have their own vectors
         uint64_t int_num = scause & 0x7FFFFFFFFFFFFFFF;
         printk("Interrupt %lu at PC 0x%lx\n", int_num, sepc);
+    } else if (!(tf->sstatus & SSTATUS_SPP)) {
+        // Faults in user mode become signals for the faulting process
+        process_t *proc = process_current();
+        if (proc) {
+            signal_force(proc, exception_signal(scause));
+        }
     } else {
+        printk_emergency();
+        // Environment calls from U-mode never get here, trap.S
+        // dispatches them straight to syscall_handler.
         switch (scause) {
-            case 8:
-                syscall_handler(tf);
-                sepc += 4;
-                asm volatile("csrw sepc, %0" :: "r"(sepc));
-                break;
-                
             case 12:
                 printk("Instruction page fault at 0x%lx (addr: 0x%lx)\n", sepc, stval);
                 break;
@@ -52,5 +170,6 @@ void trap_handler(struct trap_frame *tf) {
                 break;
         }
     }
+    
+    process_switch_frame(tf);
 }
-
@@ -1,8 +1,18 @@
 #ifndef TRAP_H
 #define TRAP_H
 
+#define MAX_HARTS 4
+#define TRAP_STACK_SIZE 8192
+
+// boot.S takes MAX_HARTS from here too
+#ifndef __ASSEMBLER__
 #include <stdint.h>
 
+/*
+ * Layout must match the offsets used in trap.S. The syscall fast path
+ * only fills ra, sp, t0-t6 and a0-a7; every other slot is valid only
+ * for traps that went through the full save path.
+ */
 struct trap_frame {
     uint64_t x1;
     uint64_t x2;
@@ -35,11 +45,41 @@ struct trap_frame {
     uint64_t x29;
     uint64_t x30;
     uint64_t x31;
+    uint64_t sepc;
+    uint64_t sstatus;
+    uint64_t scause;
+    uint64_t stval;
+    uint64_t pad;
+};
+
+/*
+ * cycles is time spent in the handler; latency is time CSR ticks between
+ * when the interrupt was due and when its handler ran (timer only).
+ */
+struct irq_stats {
+    uint64_t count;
+    uint64_t cycles;
+    uint64_t max_cycles;
+    uint64_t latency;
+    uint64_t max_latency;
 };
 
+static inline void irq_stats_record(struct irq_stats *st, uint64_t cycles, uint64_t latency) {
+    st->count++;
+    st->cycles += cycles;
+    if (cycles > st->max_cycles) st->max_cycles = cycles;
+    st->latency += latency;
+    if (latency > st->max_latency) st->max_latency = latency;
+}
+
 void trap_init(void);
 void trap_handler(struct trap_frame *tf);
-void enter_usermode(void *entry, void *user_stack);
+void trap_timer_interrupt(struct trap_frame *tf);
+void trap_software_interrupt(struct trap_frame *tf);
+void trap_external_interrupt(struct trap_frame *tf);
+void trap_set_timer(uint64_t deadline);
+void trap_dump_irq_stats(void);
+void *trap_kernel_stack(void);
 
 #endif
-
+#endif
@@ -0,0 +1,232 @@
+#include "uart.h"
+#include "plic.h"
+#include "process.h"
+#include "printk.h"
+#include "fs.h"
+#include <stddef.h>
+
+#define UART_RBR 0
+#define UART_THR 0
+#define UART_IER 1
+#define UART_FCR 2
+#define UART_IIR 2
+#define UART_LCR 3
+#define UART_MCR 4
+#define UART_LSR 5
+
+#define IER_ERBFI 0x01
+#define IER_ETBEI 0x02
+
+#define FCR_ENABLE   0x01
+#define FCR_CLEAR_RX 0x02
+#define FCR_CLEAR_TX 0x04
+
+#define LCR_8N1  0x03
+#define MCR_OUT2 0x08
+
+#define LSR_DR   0x01
+#define LSR_THRE 0x20
+
+#define CTRL_BS  0x08
+#define CTRL_DEL 0x7f
+
+static inline uint8_t uart_reg_read(int reg) {
+    return *(volatile uint8_t *)(UART0_BASE + reg);
+}
+
+static inline void uart_reg_write(int reg, uint8_t val) {
+    *(volatile uint8_t *)(UART0_BASE + reg) = val;
+}
+
+static int initialized;
+static uint8_t ier;
+
+// Software TX queue behind the 16-byte hardware FIFO
+static char tx_buf[UART_TX_SIZE];
+static uint32_t tx_head;
+static uint32_t tx_tail;
+
+/*
+ * Input line buffer: bytes in [rx_tail, rx_line) are complete lines that
+ * read() may return, [rx_line, rx_head) is the line still being edited.
+ */
+static char rx_buf[UART_RX_SIZE];
+static uint32_t rx_head;
+static uint32_t rx_line;
+static uint32_t rx_tail;
+static process_t *rx_waiter;
+
+static uint64_t tx_bytes;
+static uint64_t rx_bytes;
+static uint64_t rx_dropped;
+static uint64_t tx_stalls;
+
+static void uart_set_ier(uint8_t val) {
+    if (val != ier) {
+        ier = val;
+        uart_reg_write(UART_IER, ier);
+    }
+}
+
+// THRE means the whole FIFO is empty, so up to 16 bytes go in at once
+static void uart_tx_fill(void) {
+    if (!(uart_reg_read(UART_LSR) & LSR_THRE)) return;
+    
+    for (int i = 0; i < UART_FIFO_SIZE && tx_tail != tx_head; i++) {
+        uart_reg_write(UART_THR, tx_buf[tx_tail % UART_TX_SIZE]);
+        tx_tail++;
+        tx_bytes++;
+    }
+    
+    if (tx_tail != tx_head) {
+        uart_set_ier(ier | IER_ETBEI);
+    } else {
+        uart_set_ier(ier & ~IER_ETBEI);
+    }
+}
+
+static void uart_tx_put(char c) {
+    // Queue full: interrupts are off in the kernel, so poll the FIFO
+    while (tx_head - tx_tail >= UART_TX_SIZE) {
+        tx_stalls++;
+        uart_tx_fill();
+    }
+    tx_buf[tx_head % UART_TX_SIZE] = c;
+    tx_head++;
+}
+
+int uart_write(const void *buf, uint32_t count) {
+    const char *s = (const char *)buf;
+    
+    for (uint32_t i = 0; i < count; i++) {
+        uart_tx_put(s[i]);
+    }
+    uart_tx_fill();
+    return count;
+}
+
+// For panic output: drains the queue by polling, then writes around it
+void uart_write_sync(const char *buf, uint32_t count) {
+    while (tx_tail != tx_head) {
+        uart_tx_fill();
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        while (!(uart_reg_read(UART_LSR) & LSR_THRE)) {
+        }
+        uart_reg_write(UART_THR, buf[i]);
+    }
+}
+
+static void uart_rx_wake(void) {
+    process_t *waiter = rx_waiter;
+    if (!waiter) return;
+    
+    rx_waiter = NULL;
+    process_wake_restart(waiter);
+}
+
+static void uart_rx_char(char c) {
+    rx_bytes++;
+    
+    if (c == '\r') {
+        c = '\n';
+    }
+    
+    if (c == CTRL_BS || c == CTRL_DEL) {
+        if (rx_head != rx_line) {
+            rx_head--;
+            uart_write("\b \b", 3);
+        }
+        return;
+    }
+    
+    if (rx_head - rx_tail >= UART_RX_SIZE) {
+        rx_dropped++;
+        return;
+    }
+    rx_buf[rx_head % UART_RX_SIZE] = c;
+    rx_head++;
+    uart_tx_put(c);
+    
+    // A full buffer without a newline is handed over as a line too
+    if (c == '\n' || rx_head - rx_tail == UART_RX_SIZE) {
+        rx_line = rx_head;
+        uart_rx_wake();
+        fs_notify_console(POLLIN);
+    }
+}
+
+static void uart_irq(int irq, void *arg) {
+    (void)irq; (void)arg;
+    
+    while (uart_reg_read(UART_LSR) & LSR_DR) {
+        uart_rx_char(uart_reg_read(UART_RBR));
+    }
+    uart_tx_fill();
+}
+
+static void uart_cancel_read(process_t *proc) {
+    if (rx_waiter == proc) {
+        rx_waiter = NULL;
+    }
+}
+
+/*
+ * Returns at most one line. With no complete line buffered the caller
+ * sleeps until the RX interrupt finishes one and then re-issues the read.
+ */
+int uart_read(void *buf, uint32_t count) {
+    process_t *proc = process_current();
+    if (!proc || !initialized || rx_waiter) return -1;
+    if (count == 0) return 0;
+    
+    if (rx_tail == rx_line) {
+        rx_waiter = proc;
+        proc->cancel_wait = uart_cancel_read;
+        return (int)process_block();
+    }
+    
+    char *dest = (char *)buf;
+    uint32_t n = 0;
+    while (n < count && rx_tail != rx_line) {
+        char c = rx_buf[rx_tail % UART_RX_SIZE];
+        rx_tail++;
+        dest[n++] = c;
+        if (c == '\n') break;
+    }
+    return n;
+}
+
+uint32_t uart_poll(void) {
+    uint32_t events = 0;
+    if (rx_tail != rx_line) {
+        events |= POLLIN;
+    }
+    if (tx_head - tx_tail < UART_TX_SIZE) {
+        events |= POLLOUT;
+    }
+    return events;
+}
+
+int uart_ready(void) {
+    return initialized;
+}
+
+void uart_init(void) {
+    uart_reg_write(UART_IER, 0);
+    uart_reg_write(UART_LCR, LCR_8N1);
+    uart_reg_write(UART_FCR, FCR_ENABLE | FCR_CLEAR_RX | FCR_CLEAR_TX);
+    uart_reg_write(UART_MCR, MCR_OUT2);
+    
+    ier = 0;
+    uart_set_ier(IER_ERBFI);
+    plic_register(UART0_IRQ, uart_irq, NULL);
+    initialized = 1;
+    
+    printk("UART: ns16550a at 0x%lx, irq %d\n", UART0_BASE, UART0_IRQ);
+}
+
+void uart_dump_stats(void) {
+    printk("UART: %lu bytes out, %lu in, %lu dropped, %lu TX stalls\n",
+           tx_bytes, rx_bytes, rx_dropped, tx_stalls);
+}
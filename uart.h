@@ -0,0 +1,21 @@
+#ifndef UART_H
+#define UART_H
+
+#include <stdint.h>
+
+// QEMU virt ns16550a
+#define UART0_BASE 0x10000000UL
+
+#define UART_FIFO_SIZE 16
+#define UART_TX_SIZE   4096
+#define UART_RX_SIZE   256
+
+void uart_init(void);
+int uart_ready(void);
+int uart_write(const void *buf, uint32_t count);
+void uart_write_sync(const char *buf, uint32_t count);
+int uart_read(void *buf, uint32_t count);
+uint32_t uart_poll(void);
+void uart_dump_stats(void);
+
+#endif
@@ -2,20 +2,125 @@
 #define UNISTD_H
 
 #include <stdint.h>
+#include "ring.h"
+#include "vdso.h"
+#include "perf_uapi.h"
+#include "trace_uapi.h"
+#include "outbuf.h"
 
 #define O_RDONLY 0
 #define O_WRONLY 1
 #define O_RDWR   2
 #define O_CREAT  0x100
 #define O_TRUNC  0x200
+#define O_EXCL   0x400
 
 #define STDIN_FILENO  0
 #define STDOUT_FILENO 1
 #define STDERR_FILENO 2
 
+#define FUTEX_WAIT 0
+#define FUTEX_WAKE 1
+
+#define CLONE_VM             0x00000100
+#define CLONE_FILES          0x00000400
+#define CLONE_THREAD         0x00010000
+#define CLONE_SETTLS         0x00080000
+#define CLONE_CHILD_CLEARTID 0x00200000
+
+#define PROT_READ  0x1
+#define PROT_WRITE 0x2
+
+#define MAP_SHARED 0x01
+#define MAP_FIXED  0x10
+#define MAP_FAILED ((void *)-1)
+
+#define F_ADD_SEALS 1033
+#define F_GET_SEALS 1034
+
+#define F_SEAL_SEAL   0x1
+#define F_SEAL_SHRINK 0x2
+#define F_SEAL_GROW   0x4
+#define F_SEAL_WRITE  0x8
+
+#define PR_SET_TIMERSLACK 29
+#define PR_GET_TIMERSLACK 30
+
+#define SCHED_NORMAL   0
+#define SCHED_DEADLINE 6
+
+#define EPOLL_CTL_ADD 1
+#define EPOLL_CTL_DEL 2
+#define EPOLL_CTL_MOD 3
+
+#define EPOLLIN  0x001
+#define EPOLLOUT 0x004
+#define EPOLLERR 0x008
+#define EPOLLHUP 0x010
+#define EPOLLET  (1U << 31)
+
+#define SIGKILL 9
+#define SIGUSR1 10
+#define SIGSEGV 11
+#define SIGUSR2 12
+#define SIGTERM 15
+#define SIGCHLD 17
+
+#define SIG_DFL 0
+#define SIG_IGN 1
+
+#define SA_NODEFER 0x40000000
+
+#define SIG_BLOCK   0
+#define SIG_UNBLOCK 1
+#define SIG_SETMASK 2
+
+#define CLOCK_REALTIME  0
+#define CLOCK_MONOTONIC 1
+
 typedef int pid_t;
 typedef unsigned int size_t;
 typedef int ssize_t;
+typedef int clockid_t;
+
+struct timespec {
+    int64_t tv_sec;
+    int64_t tv_nsec;
+};
+
+struct epoll_event {
+    uint32_t events;
+    uint64_t data;
+};
+
+// Times in nanoseconds; a zero sched_period means sched_deadline
+struct sched_attr {
+    uint32_t size;
+    uint32_t sched_policy;
+    uint64_t sched_flags;
+    int32_t sched_nice;
+    uint32_t sched_priority;
+    uint64_t sched_runtime;
+    uint64_t sched_deadline;
+    uint64_t sched_period;
+};
+
+typedef uint64_t sigset_t;
+
+// Handlers take the signal number; a zero sa_restorer uses the kernel's
+struct sigaction {
+    uint64_t sa_handler;
+    sigset_t sa_mask;
+    uint64_t sa_flags;
+    uint64_t sa_restorer;
+};
+
+// Set by the program's entry point from the pointer the kernel passes in a0
+static const struct vdso_data *__vdso;
+
+static inline void vdso_attach(const struct vdso_data *vdso) {
+    __vdso = vdso;
+}
 
 static inline void exit(int status) {
     register uint64_t a0 asm("a0") = status;
@@ -24,6 +129,40 @@ static inline void exit(int status) {
     __builtin_unreachable();
 }
 
+// Ends every thread of the process, where exit() ends only the caller
+static inline void exit_group(int status) {
+    register uint64_t a0 asm("a0") = status;
+    register uint64_t a7 asm("a7") = 30;
+    asm volatile("ecall" :: "r"(a0), "r"(a7));
+    __builtin_unreachable();
+}
+
+/*
+ * Runs fn(arg) on stack (its top, 16-byte aligned) and returns the new
+ * thread id. Returning from fn exits the thread with fn's a0. With
+ * CLONE_CHILD_CLEARTID, *ctid is zeroed and futex-woken at exit.
+ */
+static inline pid_t clone(void (*fn)(void *), void *stack, int flags, void *arg,
+                          void *tls, uint32_t *ctid) {
+    register uint64_t a0 asm("a0") = flags;
+    register uint64_t a1 asm("a1") = (uint64_t)fn;
+    register uint64_t a2 asm("a2") = (uint64_t)stack;
+    register uint64_t a3 asm("a3") = (uint64_t)arg;
+    register uint64_t a4 asm("a4") = (uint64_t)tls;
+    register uint64_t a5 asm("a5") = (uint64_t)ctid;
+    register uint64_t a7 asm("a7") = 28;
+    asm volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a3), "r"(a4), "r"(a5), "r"(a7)
+                 : "memory");
+    return (pid_t)a0;
+}
+
+static inline pid_t gettid(void) {
+    register uint64_t a0 asm("a0");
+    register uint64_t a7 asm("a7") = 29;
+    asm volatile("ecall" : "=r"(a0) : "r"(a7) : "memory");
+    return (pid_t)a0;
+}
+
 static inline pid_t fork(void) {
     register uint64_t a0 asm("a0");
     register uint64_t a7 asm("a7") = 2;
@@ -72,12 +211,271 @@ static inline pid_t wait(int *status) {
 }
 
 static inline pid_t getpid(void) {
+    if (__vdso) {
+        return __atomic_load_n(&__vdso->pid, __ATOMIC_ACQUIRE);
+    }
     register uint64_t a0 asm("a0");
     register uint64_t a7 asm("a7") = 9;
     asm volatile("ecall" : "=r"(a0) : "r"(a7) : "memory");
     return (pid_t)a0;
 }
 
+static inline int clock_gettime(clockid_t clk, struct timespec *ts) {
+    if (!__vdso) {
+        register uint64_t a0 asm("a0") = clk;
+        register uint64_t a1 asm("a1") = (uint64_t)ts;
+        register uint64_t a7 asm("a7") = 16;
+        asm volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a7) : "memory");
+        return (int)a0;
+    }
+    if (clk != CLOCK_REALTIME && clk != CLOCK_MONOTONIC) {
+        return -1;
+    }
+    uint64_t now;
+    asm volatile("rdtime %0" : "=r"(now));
+    uint64_t ticks = now - __vdso->boot_time;
+    uint64_t freq = __vdso->timebase_freq;
+    uint64_t sec = ticks / freq;
+    uint64_t nsec = (ticks % freq) * 1000000000ULL / freq;
+    if (clk == CLOCK_REALTIME) {
+        sec += __vdso->boot_realtime_ns / 1000000000ULL;
+        nsec += __vdso->boot_realtime_ns % 1000000000ULL;
+        if (nsec >= 1000000000ULL) {
+            sec++;
+            nsec -= 1000000000ULL;
+        }
+    }
+    ts->tv_sec = sec;
+    ts->tv_nsec = nsec;
+    return 0;
+}
+
+static inline int futex(uint32_t *uaddr, int op, uint32_t val,
+                        const struct timespec *timeout) {
+    register uint64_t a0 asm("a0") = (uint64_t)uaddr;
+    register uint64_t a1 asm("a1") = op;
+    register uint64_t a2 asm("a2") = val;
+    register uint64_t a3 asm("a3") = (uint64_t)timeout;
+    register uint64_t a7 asm("a7") = 14;
+    asm volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a3), "r"(a7) : "memory");
+    return (int)a0;
+}
+
+static inline int nanosleep(const struct timespec *req) {
+    register uint64_t a0 asm("a0") = (uint64_t)req;
+    register uint64_t a7 asm("a7") = 15;
+    asm volatile("ecall" : "+r"(a0) : "r"(a7) : "memory");
+    return (int)a0;
+}
+
+static inline int epoll_create(void) {
+    register uint64_t a0 asm("a0");
+    register uint64_t a7 asm("a7") = 17;
+    asm volatile("ecall" : "=r"(a0) : "r"(a7) : "memory");
+    return (int)a0;
+}
+
+static inline int epoll_ctl(int epfd, int op, int fd, struct epoll_event *event) {
+    register uint64_t a0 asm("a0") = epfd;
+    register uint64_t a1 asm("a1") = op;
+    register uint64_t a2 asm("a2") = fd;
+    register uint64_t a3 asm("a3") = (uint64_t)event;
+    register uint64_t a7 asm("a7") = 18;
+    asm volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a3), "r"(a7) : "memory");
+    return (int)a0;
+}
+
+static inline int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout) {
+    register uint64_t a0 asm("a0") = epfd;
+    register uint64_t a1 asm("a1") = (uint64_t)events;
+    register uint64_t a2 asm("a2") = maxevents;
+    register uint64_t a3 asm("a3") = timeout;
+    register uint64_t a7 asm("a7") = 19;
+    asm volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a3), "r"(a7) : "memory");
+    return (int)a0;
+}
+
+static inline int kill(pid_t pid, int sig) {
+    register uint64_t a0 asm("a0") = pid;
+    register uint64_t a1 asm("a1") = sig;
+    register uint64_t a7 asm("a7") = 10;
+    asm volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a7) : "memory");
+    return (int)a0;
+}
+
+static inline int sigaction(int sig, const struct sigaction *act, struct sigaction *oldact) {
+    register uint64_t a0 asm("a0") = sig;
+    register uint64_t a1 asm("a1") = (uint64_t)act;
+    register uint64_t a2 asm("a2") = (uint64_t)oldact;
+    register uint64_t a7 asm("a7") = 20;
+    asm volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a7) : "memory");
+    return (int)a0;
+}
+
+static inline int sigprocmask(int how, const sigset_t *set, sigset_t *oldset) {
+    register uint64_t a0 asm("a0") = how;
+    register uint64_t a1 asm("a1") = (uint64_t)set;
+    register uint64_t a2 asm("a2") = (uint64_t)oldset;
+    register uint64_t a7 asm("a7") = 21;
+    asm volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a7) : "memory");
+    return (int)a0;
+}
+
+// Per-subsystem kernel log threshold; returns the old one, level -1 queries
+static inline int loglevel(int subsys, int level) {
+    register uint64_t a0 asm("a0") = subsys;
+    register uint64_t a1 asm("a1") = level;
+    register uint64_t a7 asm("a7") = 23;
+    asm volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a7) : "memory");
+    return (int)a0;
+}
+
+#define PROF_START 0
+#define PROF_STOP  1
+#define PROF_READ  2
+#define PROF_DUMP  3
+
+// Timer-sampled profiler; PROF_READ copies up to arg samples into buf
+static inline int profile(int cmd, uint64_t arg, void *buf) {
+    register uint64_t a0 asm("a0") = cmd;
+    register uint64_t a1 asm("a1") = arg;
+    register uint64_t a2 asm("a2") = (uint64_t)buf;
+    register uint64_t a7 asm("a7") = 24;
+    asm volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a7) : "memory");
+    return (int)a0;
+}
+
+// Counts for the calling process; read() on the fd yields a uint64_t
+static inline int perf_event_open(const struct perf_event_attr *attr, pid_t pid) {
+    register uint64_t a0 asm("a0") = (uint64_t)attr;
+    register uint64_t a1 asm("a1") = pid;
+    register uint64_t a7 asm("a7") = 25;
+    asm volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a7) : "memory");
+    return (int)a0;
+}
+
+static inline int perf_ctl(int fd, int cmd) {
+    register uint64_t a0 asm("a0") = fd;
+    register uint64_t a1 asm("a1") = cmd;
+    register uint64_t a7 asm("a7") = 26;
+    asm volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a7) : "memory");
+    return (int)a0;
+}
+
+// Binary event tracing; TRACE_START takes a TRACE_CLASS_* mask (0 for all)
+static inline int trace(int cmd, uint64_t arg, void *buf) {
+    register uint64_t a0 asm("a0") = cmd;
+    register uint64_t a1 asm("a1") = arg;
+    register uint64_t a2 asm("a2") = (uint64_t)buf;
+    register uint64_t a7 asm("a7") = 27;
+    asm volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a7) : "memory");
+    return (int)a0;
+}
+
+// Named shared memory; size it with ftruncate, then mmap it MAP_SHARED
+static inline int shm_open(const char *name, int flags) {
+    register uint64_t a0 asm("a0") = (uint64_t)name;
+    register uint64_t a1 asm("a1") = flags;
+    register uint64_t a7 asm("a7") = 31;
+    asm volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a7) : "memory");
+    return (int)a0;
+}
+
+static inline int shm_unlink(const char *name) {
+    register uint64_t a0 asm("a0") = (uint64_t)name;
+    register uint64_t a7 asm("a7") = 32;
+    asm volatile("ecall" : "+r"(a0) : "r"(a7) : "memory");
+    return (int)a0;
+}
+
+static inline int ftruncate(int fd, size_t length) {
+    register uint64_t a0 asm("a0") = fd;
+    register uint64_t a1 asm("a1") = length;
+    register uint64_t a7 asm("a7") = 33;
+    asm volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a7) : "memory");
+    return (int)a0;
+}
+
+// Every process mapping an object gets the same address: there is no MMU
+static inline void *mmap(void *addr, size_t length, int prot, int flags, int fd, size_t offset) {
+    register uint64_t a0 asm("a0") = (uint64_t)addr;
+    register uint64_t a1 asm("a1") = length;
+    register uint64_t a2 asm("a2") = prot;
+    register uint64_t a3 asm("a3") = flags;
+    register uint64_t a4 asm("a4") = fd;
+    register uint64_t a5 asm("a5") = offset;
+    register uint64_t a7 asm("a7") = 34;
+    asm volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a3), "r"(a4), "r"(a5), "r"(a7)
+                 : "memory");
+    return (void *)a0;
+}
+
+static inline int munmap(void *addr, size_t length) {
+    register uint64_t a0 asm("a0") = (uint64_t)addr;
+    register uint64_t a1 asm("a1") = length;
+    register uint64_t a7 asm("a7") = 35;
+    asm volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a7) : "memory");
+    return (int)a0;
+}
+
+static inline int fcntl(int fd, int cmd, uint64_t arg) {
+    register uint64_t a0 asm("a0") = fd;
+    register uint64_t a1 asm("a1") = cmd;
+    register uint64_t a2 asm("a2") = arg;
+    register uint64_t a7 asm("a7") = 36;
+    asm volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a7) : "memory");
+    return (int)a0;
+}
+
+// Only the timer slack options; slack is in nanoseconds, 0 restores the default
+static inline long prctl(int option, unsigned long arg) {
+    register uint64_t a0 asm("a0") = option;
+    register uint64_t a1 asm("a1") = arg;
+    register uint64_t a7 asm("a7") = 37;
+    asm volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a7) : "memory");
+    return (long)a0;
+}
+
+static inline int sched_setattr(pid_t pid, const struct sched_attr *attr, unsigned int flags) {
+    register uint64_t a0 asm("a0") = pid;
+    register uint64_t a1 asm("a1") = (uint64_t)attr;
+    register uint64_t a2 asm("a2") = flags;
+    register uint64_t a7 asm("a7") = 38;
+    asm volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a7) : "memory");
+    return (int)a0;
+}
+
+static inline int sched_getattr(pid_t pid, struct sched_attr *attr, unsigned int size) {
+    register uint64_t a0 asm("a0") = pid;
+    register uint64_t a1 asm("a1") = (uint64_t)attr;
+    register uint64_t a2 asm("a2") = size;
+    register uint64_t a7 asm("a7") = 39;
+    asm volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a7) : "memory");
+    return (int)a0;
+}
+
+// From a SCHED_DEADLINE task, ends the current job until the next period
+static inline int sched_yield(void) {
+    register uint64_t a0 asm("a0");
+    register uint64_t a7 asm("a7") = 40;
+    asm volatile("ecall" : "=r"(a0) : "r"(a7) : "memory");
+    return (int)a0;
+}
+
+static inline int io_ring_setup(struct io_ring *ring) {
+    register uint64_t a0 asm("a0") = (uint64_t)ring;
+    register uint64_t a7 asm("a7") = 12;
+    asm volatile("ecall" : "+r"(a0) : "r"(a7) : "memory");
+    return (int)a0;
+}
+
+static inline int io_ring_enter(unsigned int to_submit) {
+    register uint64_t a0 asm("a0") = to_submit;
+    register uint64_t a7 asm("a7") = 13;
+    asm volatile("ecall" : "+r"(a0) : "r"(a7) : "memory");
+    return (int)a0;
+}
+
 static inline size_t strlen(const char *s) {
     size_t len = 0;
     while (s[len]) len++;
@@ -1,6 +1,11 @@
 #ifndef USERMODE_H
 #define USERMODE_H
 
+struct vdso_data;
+
 void start_usermode(void);
 
+// Benchmark suite that replaces the smoke test under CONFIG_BENCH
+void bench_program(const struct vdso_data *vdso);
+
 #endif
@@ -0,0 +1,34 @@
+#include "vdso.h"
+#include "process.h"
+#include "printk.h"
+#include "riscv.h"
+
+// QEMU virt goldfish RTC, nanoseconds since the epoch
+#define RTC_BASE      0x101000UL
+#define RTC_TIME_LOW  0x00
+#define RTC_TIME_HIGH 0x04
+
+struct vdso_data vdso_page __attribute__((aligned(VDSO_PAGE_SIZE)));
+
+static uint64_t rtc_read_ns(void) {
+    volatile uint32_t *rtc = (volatile uint32_t *)RTC_BASE;
+    // Reading TIME_LOW latches TIME_HIGH
+    uint64_t low = rtc[RTC_TIME_LOW / 4];
+    uint64_t high = rtc[RTC_TIME_HIGH / 4];
+    return (high << 32) | low;
+}
+
+void vdso_init(void) {
+    vdso_page.timebase_freq = TIMEBASE_FREQ;
+    vdso_page.boot_time = read_time();
+    vdso_page.boot_realtime_ns = rtc_read_ns();
+    
+    process_t *proc = process_current();
+    vdso_page.pid = proc ? proc->pid : 0;
+    
+    printk("vDSO page at: 0x%lx\n", (uint64_t)&vdso_page);
+}
+
+void vdso_set_pid(int pid) {
+    __atomic_store_n(&vdso_page.pid, pid, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,26 @@
+#ifndef VDSO_H
+#define VDSO_H
+
+#include <stdint.h>
+
+#define VDSO_PAGE_SIZE 4096
+
+/*
+ * Kernel-maintained page handed to every process at entry (in a0).
+ * User code only reads it; monotonic time is rdtime - boot_time scaled
+ * by timebase_freq, and realtime adds boot_realtime_ns on top.
+ */
+struct vdso_data {
+    int32_t pid;
+    uint32_t pad;
+    uint64_t timebase_freq;
+    uint64_t boot_time;
+    uint64_t boot_realtime_ns;
+};
+
+extern struct vdso_data vdso_page;
+
+void vdso_init(void);
+void vdso_set_pid(int pid);
+
+#endif
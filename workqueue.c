@@ -0,0 +1,89 @@
+#include "workqueue.h"
+#include "process.h"
+#include "spinlock.h"
+#include "printk.h"
+#include <stddef.h>
+
+#define LOG_SUBSYS LOG_PROC
+
+static spinlock_t work_lock;
+static struct work *work_head;
+static struct work **work_tail = &work_head;
+static process_t *kworker;
+
+static uint64_t works_run;
+static uint64_t worker_wakeups;
+
+static struct work *work_pop(void) {
+    struct work *w = work_head;
+    if (w) {
+        work_head = w->next;
+        if (!work_head) {
+            work_tail = &work_head;
+        }
+        w->next = NULL;
+        w->pending = 0;
+    }
+    return w;
+}
+
+static void kworker_main(void *arg) {
+    (void)arg;
+    for (;;) {
+        uint64_t flags = spin_lock_irqsave(&work_lock);
+        struct work *w = work_pop();
+        if (!w) {
+            kthread_prepare_park();
+            spin_unlock_irqrestore(&work_lock, flags);
+            kthread_park();
+            continue;
+        }
+        spin_unlock_irqrestore(&work_lock, flags);
+        
+        w->fn(w);
+        works_run++;
+    }
+}
+
+void workqueue_init(void) {
+    spin_init(&work_lock, "workqueue");
+    int pid = kthread_create("kworker", kworker_main, NULL);
+    kworker = pid > 0 ? process_get(pid) : NULL;
+    if (!kworker) {
+        pr_err("workqueue: can't start kworker\n");
+    }
+}
+
+int workqueue_ready(void) {
+    return kworker != NULL;
+}
+
+void work_init(struct work *w, work_fn_t fn) {
+    w->fn = fn;
+    w->next = NULL;
+    w->pending = 0;
+}
+
+// Returns 0 if w was already waiting to run
+int work_queue(struct work *w) {
+    uint64_t flags = spin_lock_irqsave(&work_lock);
+    if (w->pending) {
+        spin_unlock_irqrestore(&work_lock, flags);
+        return 0;
+    }
+    w->pending = 1;
+    *work_tail = w;
+    work_tail = &w->next;
+    spin_unlock_irqrestore(&work_lock, flags);
+    
+    if (kworker->state == PROC_BLOCKED) {
+        worker_wakeups++;
+    }
+    kthread_wake(kworker);
+    return 1;
+}
+
+void workqueue_dump_stats(void) {
+    if (!kworker) return;
+    printk("workqueue: %lu items run, %lu kworker wakeups\n", works_run, worker_wakeups);
+}
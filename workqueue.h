@@ -0,0 +1,23 @@
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+struct work;
+typedef void (*work_fn_t)(struct work *w);
+
+/*
+ * Deferred work, run in order by the kworker kernel thread. An item
+ * queued while already pending runs once; it may requeue itself.
+ */
+struct work {
+    work_fn_t fn;
+    struct work *next;
+    int pending;
+};
+
+void workqueue_init(void);
+int workqueue_ready(void);
+void work_init(struct work *w, work_fn_t fn);
+int work_queue(struct work *w);
+void workqueue_dump_stats(void);
+
+#endif